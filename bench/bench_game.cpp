@@ -0,0 +1,368 @@
+#include "../src/game/fixed_board.h"
+#include "../src/game/game.h"
+#include "../src/game/game_manager.h"
+#include "../src/game/player_manager.h"
+#include "../src/game/solved_table.h"
+
+#include <boost/format.hpp>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+using Moves = std::vector<std::pair<int, int>>;
+
+// Game::board_ and Game::checkFinish as they were before the bitboard
+class ArrayBoard : public Board {
+public:
+    enum Cell { None, X, O, };
+
+    bool isFree(int x, int y) const override
+    {
+        return x >= 0 && x < 3 && y >= 0 && y < 3 && board_[x][y] == Cell::None;
+    }
+
+    bool place(int side, int x, int y) override
+    {
+        board_[x][y] = side == 0 ? Cell::X : Cell::O;
+        result_ = checkFinish();
+        return result_ && *result_ != Cell::None;
+    }
+
+    bool isFull() const override
+    {
+        return result_ == Cell::None;
+    }
+
+    int size() const override
+    {
+        return 3;
+    }
+
+    std::unique_ptr<Board> clone() const override
+    {
+        return std::make_unique<ArrayBoard>(*this);
+    }
+
+    void restore(const Board& other) override
+    {
+        *this = static_cast<const ArrayBoard&>(other);
+    }
+
+private:
+    std::optional<Cell> checkFinish() const
+    {
+        bool boardFull = true;
+        for (int i = 0; i < 3; ++i) {
+            if (board_[i][0] != Cell::None && board_[i][0] == board_[i][1] && board_[i][0] == board_[i][2]) return board_[i][0];
+            if (board_[0][i] != Cell::None && board_[0][i] == board_[1][i] && board_[0][i] == board_[2][i]) return board_[0][i];
+            for (int j = 0; j < 3; ++j) {
+                if (board_[i][j] == Cell::None) boardFull = false;
+            }
+        }
+
+        if (board_[0][0] != Cell::None && board_[0][0] == board_[1][1] && board_[0][0] == board_[2][2]) return board_[0][0];
+        if (board_[0][2] != Cell::None && board_[0][2] == board_[1][1] && board_[0][2] == board_[2][0]) return board_[0][2];
+
+        return boardFull ? std::make_optional(Cell::None) : std::nullopt;
+    }
+
+    std::array<std::array<Cell, 3>, 3> board_{};
+    std::optional<Cell> result_;
+};
+
+// The 3x3 bitboard Game used before FixedBoard: every win mask is tested after a move
+class Bitboard {
+public:
+    using Mask = uint16_t;
+
+    static constexpr std::array<Mask, 8> WIN_MASKS = {
+        0x007, 0x038, 0x1c0, // x = 0, 1, 2
+        0x049, 0x092, 0x124, // y = 0, 1, 2
+        0x111, 0x054,        // diagonals
+    };
+
+    bool isFree(int x, int y) const
+    {
+        return x >= 0 && x < 3 && y >= 0 && y < 3 && !((sides_[0] | sides_[1]) & bit(x, y));
+    }
+
+    bool place(int side, int x, int y)
+    {
+        sides_[side] |= bit(x, y);
+        for (auto mask : WIN_MASKS) {
+            if ((sides_[side] & mask) == mask)
+                return true;
+        }
+        return false;
+    }
+
+    bool isFull() const
+    {
+        return std::popcount(static_cast<Mask>(sides_[0] | sides_[1])) == 9;
+    }
+
+private:
+    static constexpr Mask bit(int x, int y)
+    {
+        return static_cast<Mask>(1u << (x * 3 + y));
+    }
+
+    std::array<Mask, 2> sides_{};
+};
+
+// Random games, every one is played until somebody wins or the board is full
+std::vector<Moves> makeGames(const BoardRules& rules, size_t count)
+{
+    std::mt19937 random(42);
+    std::vector<int> cells(static_cast<size_t>(rules.size * rules.size));
+    std::vector<Moves> games;
+    for (size_t i = 0; i < count; ++i) {
+        std::iota(cells.begin(), cells.end(), 0);
+        std::shuffle(cells.begin(), cells.end(), random);
+
+        GridBoard board(rules);
+        Moves moves;
+        for (int cell : cells) {
+            int x = cell / rules.size;
+            int y = cell % rules.size;
+            moves.emplace_back(x, y);
+            if (board.place(static_cast<int>(moves.size() % 2), x, y) || board.isFull())
+                break;
+        }
+        games.push_back(std::move(moves));
+    }
+    return games;
+}
+
+template <typename T>
+T& deref(T& board)
+{
+    return board;
+}
+
+template <typename T>
+T& deref(std::unique_ptr<T>& board)
+{
+    return *board;
+}
+
+// makeBoard gives a board by value or behind a pointer, the way Game holds the classic board and
+// the other ones
+template <typename MakeBoard>
+void runBoard(const char* name, MakeBoard makeBoard, const std::vector<Moves>& games, size_t rounds)
+{
+    size_t moves = 0;
+    size_t checksum = 0;
+    auto begin = Clock::now();
+    for (size_t round = 0; round < rounds; ++round) {
+        for (const auto& game : games) {
+            auto holder = makeBoard();
+            auto& board = deref(holder);
+            for (size_t i = 0; i < game.size(); ++i) {
+                auto [x, y] = game[i];
+                if (!board.isFree(x, y))
+                    break;
+                ++moves;
+                if (board.place(static_cast<int>(i % 2), x, y)) {
+                    checksum += i % 2 + 1;
+                    break;
+                }
+                if (board.isFull())
+                    break;
+            }
+        }
+    }
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - begin).count();
+
+    std::cout << boost::format("%-16s %6.2f ns/move (checksum %d)\n") % name % (ns / moves) % checksum;
+}
+
+// The whole Game::makeMove path: lock, validation, notifications and the finish check
+void runGame(const char* name, bool lockFree, const std::vector<Moves>& games, size_t rounds)
+{
+    PlayerManager playerManager;
+    auto player1 = playerManager.createPlayer("p1");
+    auto player2 = playerManager.createPlayer("p2");
+    player1->setNotificationHandler([](const Notification&) {});
+    player2->setNotificationHandler([](const Notification&) {});
+
+    size_t moves = 0;
+    auto begin = Clock::now();
+    for (size_t round = 0; round < rounds; ++round) {
+        for (const auto& game : games) {
+            Game instance(0, BoardRules{}, lockFree);
+            instance.join(player1);
+            instance.join(player2);
+            for (size_t i = 0; i < game.size(); ++i) {
+                instance.makeMove(i % 2 == 0 ? player1->id() : player2->id(), game[i].first, game[i].second);
+                ++moves;
+            }
+        }
+    }
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - begin).count();
+
+    std::cout << boost::format("%-16s %6.2f ns/move\n") % name % (ns / moves);
+}
+
+// What a bot reply costs: one table lookup per position of the replayed games
+void runBotLookup(const std::vector<Moves>& games, size_t rounds)
+{
+    size_t lookups = 0;
+    size_t checksum = 0;
+    auto begin = Clock::now();
+    for (size_t round = 0; round < rounds; ++round) {
+        for (const auto& game : games) {
+            int position = 0;
+            for (size_t i = 0; i < game.size(); ++i) {
+                position = SolvedTable::withMove(position, static_cast<int>(i % 2), game[i].first * 3 + game[i].second);
+                checksum += SolvedTable::bestMove(position);
+                ++lookups;
+            }
+        }
+    }
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - begin).count();
+
+    std::cout << boost::format("%-16s %6.2f ns/reply (checksum %d)\n") % "bot lookup" % (ns / lookups) % checksum;
+}
+
+// The registry operations of a game's life from many threads at once: createGame, a getGame per
+// move the way makeMove looks the game up, and removeGame when it ends
+void runRegistry(size_t threadCount, size_t shardCount, size_t rounds)
+{
+    constexpr size_t BATCH = 256;
+    constexpr size_t MOVES = 7;
+
+    GameManager manager(false, shardCount);
+    std::vector<std::array<double, 3>> nanos(threadCount);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < threadCount; ++i) {
+        threads.emplace_back([&manager, &result = nanos[i], rounds]()
+            {
+                std::vector<Id> ids(BATCH);
+                size_t found = 0;
+                result = {};
+                for (size_t round = 0; round < rounds; ++round) {
+                    auto begin = Clock::now();
+                    for (auto& id : ids)
+                        id = manager.createGame();
+                    auto created = Clock::now();
+                    for (size_t move = 0; move < MOVES; ++move) {
+                        for (auto id : ids)
+                            found += manager.getGame(id) != nullptr;
+                    }
+                    auto moved = Clock::now();
+                    for (auto id : ids)
+                        manager.removeGame(id);
+                    auto removed = Clock::now();
+
+                    result[0] += std::chrono::duration<double, std::nano>(created - begin).count();
+                    result[1] += std::chrono::duration<double, std::nano>(moved - created).count();
+                    result[2] += std::chrono::duration<double, std::nano>(removed - moved).count();
+                }
+                if (found != rounds * BATCH * MOVES)
+                    std::cerr << "lost games" << std::endl;
+            });
+    }
+    for (auto& thread : threads)
+        thread.join();
+
+    std::array<double, 3> total{};
+    for (const auto& result : nanos) {
+        for (size_t op = 0; op < total.size(); ++op)
+            total[op] += result[op];
+    }
+    double games = static_cast<double>(threadCount * rounds * BATCH);
+    std::cout << boost::format("registry %2d shards, %d threads: create %6.2f, lookup %6.2f, remove %6.2f ns/op\n")
+                 % shardCount % threadCount % (total[0] / games) % (total[1] / games / MOVES) % (total[2] / games);
+}
+
+// Read-mostly registry: every thread looks up the same games, while one game in a hundred lookups
+// is replaced. All games share one shard, so the shard lock is as contended as it gets.
+void runLookup(size_t threadCount, bool epochReads, size_t rounds)
+{
+    constexpr size_t GAMES = 1024;
+    constexpr size_t CHURN_EVERY = 100;
+
+    GameManager manager(false, 1, GameManager::DEFAULT_MATCH_QUEUE_CAPACITY, RatingWindow{}, epochReads);
+    std::vector<std::atomic<Id>> ids(GAMES);
+    for (auto& id : ids)
+        id.store(manager.createGame(), std::memory_order_relaxed);
+
+    std::vector<double> nanos(threadCount);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < threadCount; ++i) {
+        threads.emplace_back([&manager, &ids, &result = nanos[i], i, rounds]()
+            {
+                size_t found = 0;
+                auto begin = Clock::now();
+                for (size_t round = 0; round < rounds; ++round) {
+                    for (size_t game = 0; game < GAMES; ++game) {
+                        auto& id = ids[(game + i * 61) % GAMES];
+                        found += manager.getGame(id.load(std::memory_order_relaxed)) != nullptr;
+                        if (i == 0 && game % CHURN_EVERY == 0) {
+                            manager.removeGame(id.load(std::memory_order_relaxed));
+                            id.store(manager.createGame(), std::memory_order_relaxed);
+                        }
+                    }
+                }
+                result = std::chrono::duration<double, std::nano>(Clock::now() - begin).count();
+                // Replaced games are missed now and then, found only keeps the loop from going away
+                if (found == 0)
+                    std::cerr << "lost games" << std::endl;
+            });
+    }
+    for (auto& thread : threads)
+        thread.join();
+
+    double lookups = static_cast<double>(rounds * GAMES);
+    double slowest = *std::max_element(nanos.begin(), nanos.end());
+    std::cout << boost::format("lookup %-12s %2d threads: %6.2f ns/lookup, %7.2f M lookups/s\n")
+                 % (epochReads ? "epoch" : "shared_mutex") % threadCount
+                 % (std::accumulate(nanos.begin(), nanos.end(), 0.0) / lookups / threadCount)
+                 % (lookups * threadCount / slowest * 1e3);
+}
+
+int main(int argc, char* argv[])
+{
+    size_t rounds = argc > 1 ? std::stoul(argv[1]) : 2000;
+
+    BoardRules classic;
+    auto games = makeGames(classic, 1000);
+    runBoard("array 3x3", []() { return ArrayBoard(); }, games, rounds);
+    runBoard("bitboard 3x3", []() { return Bitboard(); }, games, rounds);
+    runBoard("fixed 3x3", []() { return FixedBoard<3, 3>(); }, games, rounds);
+    runBoard("fixed 3x3 Board*", []() { return std::make_unique<FixedBoard<3, 3>>(); }, games, rounds);
+    runBoard("grid 3x3", [&classic]() { return std::make_unique<GridBoard>(classic); }, games, rounds);
+
+    BoardRules gomoku{ .size = 15, .winLength = 5 };
+    games = makeGames(gomoku, 100);
+    runBoard("fixed 15x15/5", []() { return std::make_unique<FixedBoard<15, 5>>(); }, games, rounds / 10);
+    runBoard("grid 15x15/5", [&gomoku]() { return std::make_unique<GridBoard>(gomoku); }, games, rounds / 10);
+
+    games = makeGames(classic, 1000);
+    runGame("Game 3x3", false, games, rounds / 10);
+    runGame("Game 3x3 CAS", true, games, rounds / 10);
+    runBotLookup(games, rounds);
+
+    size_t threads = std::max(4u, std::thread::hardware_concurrency());
+    runRegistry(threads, 1, rounds / 10);
+    runRegistry(threads, GameManager::DEFAULT_SHARD_COUNT, rounds / 10);
+
+    for (size_t threadCount = 1; threadCount <= std::max(8u, std::thread::hardware_concurrency()); threadCount *= 2) {
+        runLookup(threadCount, false, rounds / 10);
+        runLookup(threadCount, true, rounds / 10);
+    }
+    return 0;
+}
@@ -0,0 +1,41 @@
+#include "../src/game/mcts.h"
+
+#include <boost/format.hpp>
+
+#include <algorithm>
+#include <future>
+#include <iostream>
+#include <string>
+#include <thread>
+
+// One bot reply: X took the center, O searches the rest of the board
+void runSearch(const BoardRules& rules, size_t threadCount, std::chrono::milliseconds budget)
+{
+    Mcts mcts(threadCount, MctsOptions{ .moveBudget = budget });
+    auto search = mcts.makeSearch();
+    auto board = makeBoard(rules);
+    board->place(0, rules.size / 2, rules.size / 2);
+
+    std::promise<MctsResult> promise;
+    mcts.search(search, *board, 1, [&promise](const MctsResult& result) { promise.set_value(result); });
+    size_t playouts = promise.get_future().get().playouts;
+
+    double seconds = std::chrono::duration<double>(budget).count();
+    double perSecond = static_cast<double>(playouts) / seconds;
+    auto name = boost::str(boost::format("%dx%d/%d") % rules.size % rules.size % rules.winLength);
+    std::cout << boost::format("%-10s %3d threads %12.0f playouts/s %12.0f per thread\n")
+                 % name % threadCount % perSecond % (perSecond / static_cast<double>(threadCount));
+}
+
+int main(int argc, char* argv[])
+{
+    std::chrono::milliseconds budget(argc > 1 ? std::stoul(argv[1]) : 500);
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (auto rules : { BoardRules{}, BoardRules{ .size = 15, .winLength = 5 } }) {
+        runSearch(rules, 1, budget);
+        if (threads > 1)
+            runSearch(rules, threads, budget);
+    }
+    return 0;
+}
@@ -0,0 +1,78 @@
+#include "../src/web/common/command_parser.h"
+
+#include <boost/algorithm/string.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/format.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static size_t allocations = 0;
+
+void* operator new(size_t size)
+{
+    ++allocations;
+    if (void* ptr = std::malloc(size))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+// What Session::onReadAsync and processCommand did before: copy the frame out of the buffer,
+// split it into strings and convert with stoi
+int parseCopying(const boost::beast::flat_buffer& buf)
+{
+    auto data = boost::beast::buffers_to_string(buf.data());
+    std::vector<std::string> parts;
+    boost::split(parts, data, boost::is_any_of(" "));
+    return std::stoi(parts[0]) + std::stoi(parts[1]) + std::stoi(parts[2]);
+}
+
+int parseInPlace(const boost::beast::flat_buffer& buf)
+{
+    auto data = buf.data();
+    CommandTokens parts(std::string_view(static_cast<const char*>(data.data()), data.size()));
+    return *parseNumber<int>(parts[0]) + *parseNumber<int>(parts[1]) + *parseNumber<int>(parts[2]);
+}
+
+template <typename Parse>
+void run(const char* name, Parse parse, const boost::beast::flat_buffer& buf, size_t iterations)
+{
+    size_t checksum = 0;
+    size_t allocationsBefore = allocations;
+    auto begin = Clock::now();
+    for (size_t i = 0; i < iterations; ++i)
+        checksum += parse(buf);
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - begin).count();
+
+    std::cout << boost::format("%-10s %8.1f ns/command, %5.2f allocations/command (checksum %d)\n")
+            % name % (ns / iterations) % (static_cast<double>(allocations - allocationsBefore) / iterations) % checksum;
+}
+
+int main(int argc, char* argv[])
+{
+    size_t iterations = argc > 1 ? std::stoul(argv[1]) : 5'000'000;
+
+    boost::beast::flat_buffer buf;
+    std::string command = "5 1 2";
+    buf.commit(boost::asio::buffer_copy(buf.prepare(command.size()), boost::asio::buffer(command)));
+
+    run("copying", parseCopying, buf, iterations);
+    run("in-place", parseInPlace, buf, iterations);
+    return 0;
+}
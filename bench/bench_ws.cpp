@@ -0,0 +1,248 @@
+#include "../src/web/server.h"
+#include "../src/web/common/command_code.h"
+#include "../src/web/common/handshake.h"
+#include "../src/web/common/tools.h"
+
+#include <boost/format.hpp>
+#include <boost/program_options.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <new>
+#include <thread>
+#include <vector>
+
+namespace po = boost::program_options;
+namespace websocket = boost::beast::websocket;
+using tcp = boost::asio::ip::tcp;
+using Clock = std::chrono::steady_clock;
+
+// Only allocations made by server threads are counted, the clients run in the same process
+static std::atomic<size_t> serverAllocations = 0;
+static thread_local bool clientThread = false;
+
+void* operator new(size_t size)
+{
+    if (!clientThread)
+        serverAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+struct BenchClient {
+    explicit BenchClient(boost::asio::io_context& ioc)
+        : resolver_(ioc), ws_(ioc)
+    {}
+
+    void connect(const std::string& port, const std::string& target)
+    {
+        auto const results = resolver_.resolve("127.0.0.1", port);
+        boost::asio::connect(ws_.next_layer(), results);
+        ws_.next_layer().set_option(tcp::no_delay(true));
+        ws_.handshake("127.0.0.1", target);
+        options_ = parseHandshakeOptions(target);
+        ws_.binary(options_.encoding == Encoding::Binary);
+    }
+
+    void auth(const std::string& nickname)
+    {
+        if (options_.encoding == Encoding::Text)
+            return send((boost::format("%d %s") % InCommandCode::AUTH % nickname).str());
+
+        std::string message(1, static_cast<char>(InCommandCode::AUTH));
+        writeString(message, nickname);
+        send(message);
+    }
+
+    void createGame()
+    {
+        if (options_.encoding == Encoding::Text)
+            return send(std::to_string(InCommandCode::CREATE_GAME));
+        send(std::string(1, static_cast<char>(InCommandCode::CREATE_GAME)));
+    }
+
+    void joinGame(const std::string& gameId)
+    {
+        if (options_.encoding == Encoding::Text)
+            return send((boost::format("%d %s") % InCommandCode::JOIN_GAME % gameId).str());
+
+        std::string message(1, static_cast<char>(InCommandCode::JOIN_GAME));
+        writeVarint(message, std::stoul(gameId));
+        send(message);
+    }
+
+    void move(int x, int y)
+    {
+        if (options_.encoding == Encoding::Text)
+            return send((boost::format("%d %d %d") % InCommandCode::MOVE % x % y).str());
+        send(std::string{ static_cast<char>(InCommandCode::MOVE), packMove(x, y) });
+    }
+
+    Message receiveMessage()
+    {
+        if (pending_.empty()) {
+            buffer_.clear();
+            ws_.read(buffer_);
+            auto data = boost::beast::buffers_to_string(buffer_.data());
+            if (options_.batch) {
+                auto messages = splitBatchedFrame(data, options_.encoding);
+                pending_.insert(pending_.end(), messages.begin(), messages.end());
+            } else {
+                pending_.push_back(data);
+            }
+        }
+
+        auto data = pending_.front();
+        pending_.pop_front();
+        return options_.encoding == Encoding::Binary ? getInBinaryMessage(data) : getInMessage(data);
+    }
+
+private:
+    void send(const std::string& message)
+    {
+        ws_.write(boost::asio::buffer(message));
+    }
+
+    tcp::resolver resolver_;
+    websocket::stream<tcp::socket> ws_;
+    boost::beast::flat_buffer buffer_;
+    std::deque<std::string> pending_;
+    HandshakeOptions options_;
+};
+
+struct PairResult {
+    size_t messages = 0;
+    std::vector<double> moveLatenciesUs;
+};
+
+// Five moves that win the game for X, so every game fans out ten MOVED and two GAME_ENDED notifications
+const std::array<std::pair<int, int>, 5> kWinningMoves = {{ {0, 0}, {1, 0}, {0, 1}, {1, 1}, {0, 2} }};
+
+void playGames(const std::string& port, const std::string& target, size_t games, PairResult& result)
+{
+    clientThread = true;
+    boost::asio::io_context ioc;
+    BenchClient client1(ioc);
+    BenchClient client2(ioc);
+
+    client1.connect(port, target);
+    client1.auth("bench1");
+    client1.receiveMessage();
+    client2.connect(port, target);
+    client2.auth("bench2");
+    client2.receiveMessage();
+
+    for (size_t game = 0; game < games; ++game) {
+        client1.createGame();
+        auto gameId = client1.receiveMessage().message;
+        client2.joinGame(gameId);
+        client2.receiveMessage();
+        client1.receiveMessage();
+        result.messages += 3;
+
+        for (size_t i = 0; i < kWinningMoves.size(); ++i) {
+            auto& mover = (i % 2 == 0) ? client1 : client2;
+            auto& opponent = (i % 2 == 0) ? client2 : client1;
+
+            auto begin = Clock::now();
+            mover.move(kWinningMoves[i].first, kWinningMoves[i].second);
+            opponent.receiveMessage();
+            result.moveLatenciesUs.push_back(std::chrono::duration<double, std::micro>(Clock::now() - begin).count());
+            mover.receiveMessage();
+            result.messages += 2;
+        }
+
+        client1.receiveMessage();
+        client2.receiveMessage();
+        result.messages += 2;
+    }
+}
+
+double percentile(std::vector<double>& values, double p)
+{
+    if (values.empty())
+        return 0;
+    auto index = static_cast<size_t>(p * static_cast<double>(values.size() - 1));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+int main(int argc, char* argv[])
+{
+    size_t threads, pairs, games, port;
+    bool batch, binary;
+    ServerOptions options;
+
+    po::options_description description("WsBench options");
+    description.add_options()
+        ("help", "show help")
+        ("threads", po::value(&threads)->default_value(std::max(1u, std::thread::hardware_concurrency())), "server worker threads")
+        ("pairs", po::value(&pairs)->default_value(64), "concurrent client pairs")
+        ("games", po::value(&games)->default_value(100), "games played by every pair")
+        ("port", po::value(&port)->default_value(8090), "server port")
+        ("sharded", po::bool_switch(&options.sharded), "one io_context per worker thread")
+        ("reuse-port", po::bool_switch(&options.reusePort), "one SO_REUSEPORT acceptor per worker thread")
+        ("coroutines", po::bool_switch(&options.coroutines), "sessions run as coroutines")
+        ("lock-free-games", po::bool_switch(&options.lockFreeGames), "moves are applied with a CAS instead of the game mutex")
+        ("epoch-reads", po::bool_switch(&options.epochReads), "games are looked up without the registry locks")
+        ("batch", po::bool_switch(&batch), "clients ask for batched frames")
+        ("binary", po::bool_switch(&binary), "clients use the binary protocol");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, description), vm);
+    po::notify(vm);
+    if (vm.count("help")) {
+        std::cout << description << std::endl;
+        return 0;
+    }
+
+    Server server(threads, port, options);
+    std::thread serverThread([&server]() { server.start(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+    std::string target = (boost::format("/?batch=%d&encoding=%s") % batch % (binary ? "binary" : "text")).str();
+    std::vector<PairResult> results(pairs);
+    std::vector<std::thread> clients;
+    size_t allocationsBefore = serverAllocations;
+    auto begin = Clock::now();
+    for (size_t i = 0; i < pairs; ++i)
+        clients.emplace_back(playGames, std::to_string(port), target, games, std::ref(results[i]));
+    for (auto& client : clients)
+        client.join();
+    double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+    size_t allocations = serverAllocations - allocationsBefore;
+
+    size_t messages = 0;
+    std::vector<double> latencies;
+    for (auto& result : results) {
+        messages += result.messages;
+        latencies.insert(latencies.end(), result.moveLatenciesUs.begin(), result.moveLatenciesUs.end());
+    }
+
+    std::cout << boost::format("threads=%d pairs=%d games=%d sharded=%d reuse-port=%d coroutines=%d batch=%d binary=%d\n")
+            % threads % pairs % games % options.sharded % options.reusePort % options.coroutines % batch % binary;
+    std::cout << boost::format("moves/s: %.0f, messages/s: %.0f\n") % (latencies.size() / seconds) % (messages / seconds);
+    std::cout << boost::format("move -> opponent notification latency, us: p50 %.1f, p99 %.1f\n")
+            % percentile(latencies, 0.5) % percentile(latencies, 0.99);
+    std::cout << boost::format("messages per socket write: %.2f\n") % server.stats().messagesPerWrite();
+    std::cout << boost::format("server allocations per message: %.2f\n") % (static_cast<double>(allocations) / messages);
+
+    server.stop();
+    serverThread.join();
+    return 0;
+}
@@ -0,0 +1,324 @@
+#include "../src/game/bot.h"
+#include "../src/game/game_manager.h"
+#include "../src/game/player_manager.h"
+#include "../src/game/rating.h"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/format.hpp>
+#include <boost/program_options.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace po = boost::program_options;
+using Clock = std::chrono::steady_clock;
+
+// Counted per thread, so the counter itself doesn't become the contended cache line
+static thread_local size_t allocations = 0;
+
+void* operator new(size_t size)
+{
+    ++allocations;
+    if (void* ptr = std::malloc(size))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+enum class Mode { Random, Bot, Matchmaking };
+
+struct SimOptions {
+    Mode mode = Mode::Random;
+    BoardRules rules;
+    size_t games = 0;
+
+    // Matchmaking: a population of players with hidden skills queues for rated matches in simulated time
+    size_t players = 0;
+    double arrivalsPerSecond = 0;
+    double duration = 0;
+    double tick = 0;
+    double matchInterval = 0;
+    RatingWindow window;
+};
+
+struct WorkerResult {
+    size_t games = 0;
+    size_t moves = 0;
+    size_t allocations = 0;
+};
+
+// X always plays a random free cell. O does too, or is the perfect-play bot, whose replies
+// run on the worker's own io_context.
+void simulate(const std::shared_ptr<GameManager>& manager, PlayerManager& playerManager, const SimOptions& options,
+              unsigned seed, WorkerResult& result)
+{
+    boost::asio::io_context ioc;
+    std::mt19937 random(seed);
+    std::vector<bool> taken(static_cast<size_t>(options.rules.size * options.rules.size));
+    auto size = options.rules.size;
+
+    auto player1 = playerManager.createPlayer("x");
+    auto player2 = playerManager.createPlayer("o");
+    player1->setNotificationHandler([&taken, &result, size](const Notification& notification)
+        {
+            if (notification.type == Notification::Type::PlayerMoved) {
+                taken[static_cast<size_t>(notification.x * size + notification.y)] = true;
+                ++result.moves;
+            }
+        });
+    player2->setNotificationHandler([](const Notification&) {});
+
+    size_t allocationsBefore = allocations;
+    for (size_t game = 0; game < options.games; ++game) {
+        std::fill(taken.begin(), taken.end(), false);
+        auto gameId = manager->createGame(options.rules);
+        manager->addPlayerToGame(player1, gameId);
+        auto opponent = options.mode == Mode::Bot ? Bot::createPerfect(playerManager, manager, ioc.get_executor())
+                                                  : player2;
+        manager->addPlayerToGame(opponent, gameId);
+
+        auto mover = player1;
+        while (player1->isInGame()) {
+            auto free = static_cast<size_t>(std::count(taken.begin(), taken.end(), false));
+            auto pick = std::uniform_int_distribution<size_t>(0, free - 1)(random);
+            size_t cell = 0;
+            for (; taken[cell] || pick; ++cell) {
+                if (!taken[cell])
+                    --pick;
+            }
+            manager->makeMove(mover, static_cast<int>(cell) / size, static_cast<int>(cell) % size);
+
+            if (options.mode == Mode::Bot) {
+                ioc.restart();
+                ioc.run();
+            } else {
+                mover = mover == player1 ? player2 : player1;
+            }
+        }
+        ++result.games;
+    }
+    result.allocations = allocations - allocationsBefore;
+}
+
+double seconds(uint64_t nanos)
+{
+    return static_cast<double>(nanos) / 1e9;
+}
+
+double percentile(std::vector<double>& values, double p)
+{
+    if (values.empty())
+        return 0;
+    auto index = static_cast<size_t>(p * static_cast<double>(values.size() - 1));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+// Idle players queue for a rated match at random. Every game is decided at once, the better
+// skilled side wins as often as Elo predicts from the skills, so ratings drift towards the skills.
+int simulateMatchmaking(const SimOptions& options)
+{
+    using Clock = RatingPool::Clock;
+
+    GameManager manager(false, GameManager::DEFAULT_SHARD_COUNT, GameManager::DEFAULT_MATCH_QUEUE_CAPACITY, options.window);
+    PlayerManager playerManager;
+    std::mt19937 random(1);
+    std::normal_distribution<double> skillDistribution(INITIAL_RATING, 300.0);
+
+    std::vector<std::shared_ptr<Player>> players;
+    std::vector<double> skills;
+    std::vector<double> arrivedAt(options.players);
+    std::unordered_map<Id, size_t> indexById;
+    std::vector<size_t> idle;
+    for (size_t i = 0; i < options.players; ++i) {
+        players.push_back(playerManager.createPlayer("p" + std::to_string(i)));
+        skills.push_back(skillDistribution(random));
+        indexById.emplace(players.back()->id(), i);
+        idle.push_back(i);
+    }
+
+    std::vector<double> waits;
+    std::vector<double> ratingGaps;
+    std::vector<double> skillGaps;
+    double now = 0;
+    auto start = Clock::now();
+    auto at = [start](double time) { return start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(time)); };
+
+    auto play = [&](Id gameId) {
+        auto game = manager.getGame(gameId);
+        auto first = indexById.at(game->player1()->id());
+        auto second = indexById.at(game->player2()->id());
+        waits.push_back(now - arrivedAt[first]);
+        waits.push_back(now - arrivedAt[second]);
+        ratingGaps.push_back(std::abs(players[first]->rating() - players[second]->rating()));
+        skillGaps.push_back(std::abs(skills[first] - skills[second]));
+
+        bool firstWins = std::bernoulli_distribution(expectedScore(skills[first], skills[second]))(random);
+        manager.leavePlayerFromGame(players[firstWins ? second : first]);
+        idle.push_back(first);
+        idle.push_back(second);
+    };
+
+    uint64_t lookupNanos = 0;
+    size_t lookups = 0;
+    std::poisson_distribution<size_t> arrivals(options.arrivalsPerSecond * options.tick);
+    double nextMatching = 0;
+    for (; now < options.duration; now += options.tick) {
+        for (size_t n = arrivals(random); n > 0 && !idle.empty(); --n) {
+            auto pick = std::uniform_int_distribution<size_t>(0, idle.size() - 1)(random);
+            auto index = idle[pick];
+            idle[pick] = idle.back();
+            idle.pop_back();
+            arrivedAt[index] = now;
+
+            auto begin = Clock::now();
+            auto match = manager.ratedMatch(players[index], at(now));
+            lookupNanos += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count();
+            ++lookups;
+            if (match && std::holds_alternative<Id>(*match))
+                play(std::get<Id>(*match));
+        }
+        if (now >= nextMatching) {
+            for (auto gameId : manager.matchRatedPlayers(at(now)))
+                play(gameId);
+            nextMatching = now + options.matchInterval;
+        }
+    }
+
+    // How well the ratings found the skills
+    double meanRating = 0, meanSkill = 0;
+    for (size_t i = 0; i < players.size(); ++i) {
+        meanRating += players[i]->rating() / players.size();
+        meanSkill += skills[i] / players.size();
+    }
+    double covariance = 0, ratingVariance = 0, skillVariance = 0;
+    for (size_t i = 0; i < players.size(); ++i) {
+        covariance += (players[i]->rating() - meanRating) * (skills[i] - meanSkill);
+        ratingVariance += std::pow(players[i]->rating() - meanRating, 2);
+        skillVariance += std::pow(skills[i] - meanSkill, 2);
+    }
+    double correlation = ratingVariance > 0 && skillVariance > 0 ? covariance / std::sqrt(ratingVariance * skillVariance) : 0;
+
+    std::cout << boost::format("mode=matchmaking players=%d arrivals/s=%.0f simulated=%.0fs window=%.0f+%.0f/s up to %.0f\n")
+            % options.players % options.arrivalsPerSecond % options.duration
+            % options.window.initial % options.window.widenPerSecond % options.window.max;
+    std::cout << boost::format("games: %d, still waiting: %d\n") % ratingGaps.size() % (players.size() - idle.size());
+    std::cout << boost::format("wait, s: p50 %.1f, p90 %.1f, p99 %.1f\n")
+            % percentile(waits, 0.5) % percentile(waits, 0.9) % percentile(waits, 0.99);
+    std::cout << boost::format("rating gap: p50 %.0f, p90 %.0f, p99 %.0f\n")
+            % percentile(ratingGaps, 0.5) % percentile(ratingGaps, 0.9) % percentile(ratingGaps, 0.99);
+    std::cout << boost::format("skill gap: p50 %.0f, p90 %.0f, p99 %.0f\n")
+            % percentile(skillGaps, 0.5) % percentile(skillGaps, 0.9) % percentile(skillGaps, 0.99);
+    std::cout << boost::format("rating-skill correlation: %.3f\n") % correlation;
+    std::cout << boost::format("rated match lookup: %.0f ns\n") % (lookups ? static_cast<double>(lookupNanos) / lookups : 0.0);
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    size_t threads;
+    std::string mode;
+    bool lockFree;
+    size_t shards;
+    SimOptions options;
+
+    po::options_description description("GameSim options");
+    description.add_options()
+        ("help", "show help")
+        ("threads", po::value(&threads)->default_value(std::max(1u, std::thread::hardware_concurrency())), "simulating threads")
+        ("games", po::value(&options.games)->default_value(100000), "games played by every thread")
+        ("mode", po::value(&mode)->default_value("random"),
+         "random: both sides play random moves, bot: O is the perfect-play bot, matchmaking: rated matchmaking")
+        ("size", po::value(&options.rules.size)->default_value(3), "board size")
+        ("win-length", po::value(&options.rules.winLength)->default_value(3), "marks in a row that win")
+        ("lock-free-games", po::bool_switch(&lockFree), "moves are applied with a CAS instead of the game mutex")
+        ("shards", po::value(&shards)->default_value(GameManager::DEFAULT_SHARD_COUNT), "game registry shards")
+        ("players", po::value(&options.players)->default_value(50000), "matchmaking: player population")
+        ("arrivals", po::value(&options.arrivalsPerSecond)->default_value(2000), "matchmaking: players queueing per simulated second")
+        ("duration", po::value(&options.duration)->default_value(600), "matchmaking: simulated seconds")
+        ("tick", po::value(&options.tick)->default_value(0.01), "matchmaking: simulated seconds per step")
+        ("match-interval", po::value(&options.matchInterval)->default_value(0.25), "matchmaking: simulated seconds between pairing passes")
+        ("window", po::value(&options.window.initial)->default_value(RatingWindow{}.initial), "matchmaking: initial rating window")
+        ("widen", po::value(&options.window.widenPerSecond)->default_value(RatingWindow{}.widenPerSecond), "matchmaking: window growth per second")
+        ("max-window", po::value(&options.window.max)->default_value(RatingWindow{}.max), "matchmaking: widest rating window");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, description), vm);
+    po::notify(vm);
+    if (vm.count("help")) {
+        std::cout << description << std::endl;
+        return 0;
+    }
+
+    if (mode == "matchmaking") {
+        options.mode = Mode::Matchmaking;
+        return simulateMatchmaking(options);
+    }
+
+    options.mode = mode == "bot" ? Mode::Bot : Mode::Random;
+    if (!options.rules.isValid() || (mode != "bot" && mode != "random") || (options.mode == Mode::Bot && !options.rules.isClassic())) {
+        std::cerr << "the bot only plays the classic 3x3 board, the board must be valid" << std::endl;
+        return 1;
+    }
+
+    auto manager = std::make_shared<GameManager>(lockFree, shards);
+    PlayerManager playerManager;
+    std::vector<WorkerResult> results(threads);
+    std::vector<std::thread> workers;
+    auto begin = Clock::now();
+    for (size_t i = 0; i < threads; ++i) {
+        workers.emplace_back(simulate, std::cref(manager), std::ref(playerManager), std::cref(options),
+                             static_cast<unsigned>(i + 1), std::ref(results[i]));
+    }
+    for (auto& worker : workers)
+        worker.join();
+    double elapsed = std::chrono::duration<double>(Clock::now() - begin).count();
+
+    WorkerResult total;
+    for (const auto& result : results) {
+        total.games += result.games;
+        total.moves += result.moves;
+        total.allocations += result.allocations;
+    }
+
+    uint64_t registryWait = 0;
+    uint64_t registryContended = 0;
+    size_t busiestShard = 0;
+    for (size_t shard = 0; shard < manager->shardCount(); ++shard) {
+        const auto& stats = manager->shardLockStats(shard);
+        registryWait += stats.waitNanos;
+        registryContended += stats.contended;
+        if (stats.waitNanos > manager->shardLockStats(busiestShard).waitNanos)
+            busiestShard = shard;
+    }
+    const auto& busiest = manager->shardLockStats(busiestShard);
+    const auto& games = manager->gameLockStats();
+
+    std::cout << boost::format("threads=%d mode=%s board=%dx%d/%d lock-free-games=%d shards=%d\n")
+            % threads % mode % options.rules.size % options.rules.size % options.rules.winLength % lockFree % shards;
+    std::cout << boost::format("games/s: %.0f, moves/s: %.0f\n") % (total.games / elapsed) % (total.moves / elapsed);
+    std::cout << boost::format("lock wait, s: registry %.3f (%d contended), games %.3f (%d contended)\n")
+            % seconds(registryWait) % registryContended % seconds(games.waitNanos) % games.contended.load();
+    std::cout << boost::format("busiest shard %d: %.3f s (%d contended)\n")
+            % busiestShard % seconds(busiest.waitNanos) % busiest.contended.load();
+    std::cout << boost::format("allocations per game: %.2f\n") % (static_cast<double>(total.allocations) / total.games);
+    return 0;
+}
@@ -0,0 +1,79 @@
+#include "board.h"
+#include "fixed_board.h"
+
+#include <array>
+#include <utility>
+
+std::unique_ptr<Board> makeBoard(const BoardRules& rules)
+{
+    // Common variants get a board specialized for their size, the rest fall back to GridBoard
+    if (rules.isClassic())
+        return std::make_unique<FixedBoard<3, 3>>();
+    if (rules.size == 15 && rules.winLength == 5)
+        return std::make_unique<FixedBoard<15, 5>>();
+    return std::make_unique<GridBoard>(rules);
+}
+
+GridBoard::GridBoard(const BoardRules& rules)
+    : size_(rules.size)
+    , winLength_(rules.winLength)
+    , moves_(0)
+{
+    size_t words = (static_cast<size_t>(size_ * size_) + 63) / 64;
+    cells_[0].resize(words);
+    cells_[1].resize(words);
+}
+
+bool GridBoard::isFree(int x, int y) const
+{
+    return x >= 0 && x < size_ && y >= 0 && y < size_ && !has(0, x, y) && !has(1, x, y);
+}
+
+bool GridBoard::place(int side, int x, int y)
+{
+    size_t index = static_cast<size_t>(x * size_ + y);
+    cells_[side][index / 64] |= uint64_t(1) << (index % 64);
+    ++moves_;
+
+    static constexpr std::array<std::pair<int, int>, 4> directions = {{ {1, 0}, {0, 1}, {1, 1}, {1, -1} }};
+    for (auto [dx, dy] : directions) {
+        if (1 + countRun(side, x, y, dx, dy) + countRun(side, x, y, -dx, -dy) >= winLength_)
+            return true;
+    }
+    return false;
+}
+
+bool GridBoard::isFull() const
+{
+    return moves_ == size_ * size_;
+}
+
+int GridBoard::size() const
+{
+    return size_;
+}
+
+std::unique_ptr<Board> GridBoard::clone() const
+{
+    return std::make_unique<GridBoard>(*this);
+}
+
+void GridBoard::restore(const Board& other)
+{
+    *this = static_cast<const GridBoard&>(other);
+}
+
+bool GridBoard::has(int side, int x, int y) const
+{
+    size_t index = static_cast<size_t>(x * size_ + y);
+    return (cells_[side][index / 64] >> (index % 64)) & 1;
+}
+
+// Marks of the side next to (x, y) going in one direction, stops once a win is certain
+int GridBoard::countRun(int side, int x, int y, int dx, int dy) const
+{
+    int count = 0;
+    for (x += dx, y += dy; count < winLength_ && x >= 0 && x < size_ && y >= 0 && y < size_ && has(side, x, y); x += dx, y += dy)
+        ++count;
+    return count;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Board size and the number of marks in a row that wins, chosen when the game is created
+struct BoardRules {
+    // The binary protocol packs a move into one byte, a nibble per coordinate
+    static constexpr int MIN_SIZE = 3;
+    static constexpr int MAX_SIZE = 16;
+
+    int size = 3;
+    int winLength = 3;
+
+    bool isValid() const
+    {
+        return size >= MIN_SIZE && size <= MAX_SIZE && winLength >= MIN_SIZE && winLength <= size;
+    }
+
+    bool isClassic() const
+    {
+        return size == 3 && winLength == 3;
+    }
+};
+
+// Cells of a game. Side 0 plays X, side 1 plays O.
+class Board {
+public:
+    virtual ~Board() = default;
+
+    // In range and not taken yet
+    virtual bool isFree(int x, int y) const = 0;
+    // Puts the side's mark into a free cell, returns true if it completes a winning line
+    virtual bool place(int side, int x, int y) = 0;
+    virtual bool isFull() const = 0;
+    virtual int size() const = 0;
+
+    virtual std::unique_ptr<Board> clone() const = 0;
+    // Copies the cells of another board of the same kind, without allocating
+    virtual void restore(const Board& other) = 0;
+};
+
+std::unique_ptr<Board> makeBoard(const BoardRules& rules);
+
+// Any size: one bit per cell and side, a move only checks the four lines through its cell
+class GridBoard : public Board {
+public:
+    explicit GridBoard(const BoardRules& rules);
+
+    bool isFree(int x, int y) const override;
+    bool place(int side, int x, int y) override;
+    bool isFull() const override;
+    int size() const override;
+
+    std::unique_ptr<Board> clone() const override;
+    void restore(const Board& other) override;
+
+private:
+    bool has(int side, int x, int y) const;
+    int countRun(int side, int x, int y, int dx, int dy) const;
+
+    int size_;
+    int winLength_;
+    int moves_;
+    std::vector<uint64_t> cells_[2];
+};
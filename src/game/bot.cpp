@@ -0,0 +1,78 @@
+#include "bot.h"
+#include "solved_table.h"
+
+#include <boost/asio/post.hpp>
+
+std::shared_ptr<Player> Bot::createPerfect(PlayerManager& playerManager,
+                                           std::shared_ptr<GameManager> gameManager,
+                                           boost::asio::any_io_executor executor)
+{
+    auto bot = playerManager.createPlayer("bot", true);
+
+    // The handler is owned by the bot player, so it only keeps a weak reference back to it.
+    // Notifications of one game arrive in move order, the position needs no locking.
+    bot->setNotificationHandler([weakBot = std::weak_ptr(bot), gameManager = std::move(gameManager),
+                                 executor = std::move(executor), position = 0](const Notification& notification) mutable
+        {
+            if (notification.type != Notification::Type::PlayerMoved)
+                return;
+
+            int side = notification.mark == 'X' ? 0 : 1;
+            position = SolvedTable::withMove(position, side, notification.x * 3 + notification.y);
+            if (side != 0)
+                return; // the bot plays O, this was its own move
+
+            auto cell = SolvedTable::bestMove(position);
+            if (cell == SolvedTable::NO_MOVE)
+                return;
+
+            boost::asio::post(executor, [weakBot, gameManager, cell]()
+                {
+                    if (auto bot = weakBot.lock())
+                        gameManager->makeMove(bot, cell / 3, cell % 3);
+                });
+        });
+
+    return bot;
+}
+
+std::shared_ptr<Player> Bot::createMcts(PlayerManager& playerManager,
+                                        std::shared_ptr<GameManager> gameManager,
+                                        boost::asio::any_io_executor executor,
+                                        std::shared_ptr<Mcts> mcts,
+                                        const BoardRules& rules)
+{
+    struct State {
+        std::unique_ptr<Board> board;
+        std::shared_ptr<Mcts::Search> search;
+    };
+
+    auto bot = playerManager.createPlayer("bot", true);
+    auto state = std::make_shared<State>(State{ .board = makeBoard(rules), .search = mcts->makeSearch() });
+
+    // The bot keeps a board of the same type as the game's, so the search starts from a copy of it
+    bot->setNotificationHandler([weakBot = std::weak_ptr(bot), gameManager = std::move(gameManager),
+                                 executor = std::move(executor), mcts = std::move(mcts), state](const Notification& notification)
+        {
+            if (notification.type != Notification::Type::PlayerMoved)
+                return;
+
+            int side = notification.mark == 'X' ? 0 : 1;
+            bool won = state->board->place(side, notification.x, notification.y);
+            if (side != 0 || won || state->board->isFull())
+                return;
+
+            mcts->search(state->search, *state->board, 1, [weakBot, gameManager, executor](const MctsResult& result)
+                {
+                    if (result.x < 0)
+                        return;
+                    boost::asio::post(executor, [weakBot, gameManager, result]()
+                        {
+                            if (auto bot = weakBot.lock())
+                                gameManager->makeMove(bot, result.x, result.y);
+                        });
+                });
+        });
+
+    return bot;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "game_manager.h"
+#include "mcts.h"
+#include "player_manager.h"
+
+#include <boost/asio/any_io_executor.hpp>
+
+#include <memory>
+
+// Who takes the second seat of a new game
+enum class Opponent {
+    Player = 0,
+    Bot    = 1,
+};
+
+// Server-side players with no session behind them. A bot follows the game through its own
+// notifications and answers the opponent's moves on the executor, never from inside makeMove,
+// which still holds the game lock.
+class Bot {
+public:
+    // Classic games only: the reply is looked up in SolvedTable
+    static std::shared_ptr<Player> createPerfect(PlayerManager& playerManager,
+                                                 std::shared_ptr<GameManager> gameManager,
+                                                 boost::asio::any_io_executor executor);
+
+    // Any board: the reply is searched by mcts on its own threads, within its move budget
+    static std::shared_ptr<Player> createMcts(PlayerManager& playerManager,
+                                              std::shared_ptr<GameManager> gameManager,
+                                              boost::asio::any_io_executor executor,
+                                              std::shared_ptr<Mcts> mcts,
+                                              const BoardRules& rules);
+};
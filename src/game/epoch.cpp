@@ -0,0 +1,138 @@
+#include "epoch.h"
+
+#include <algorithm>
+
+namespace {
+
+// The thread's record, given back when the thread exits
+struct ThreadRecord {
+    ~ThreadRecord()
+    {
+        if (used)
+            used->store(false, std::memory_order_release);
+    }
+
+    void* record = nullptr;
+    std::atomic_bool* used = nullptr;
+};
+
+thread_local ThreadRecord threadRecord;
+
+} // namespace
+
+EpochDomain::Guard::Guard(EpochDomain& domain)
+    : domain_(domain)
+{
+    domain_.enter();
+}
+
+EpochDomain::Guard::~Guard()
+{
+    domain_.exit();
+}
+
+// Never destroyed: threads may still be unpinning while the process exits
+EpochDomain& EpochDomain::instance()
+{
+    static auto* domain = new EpochDomain();
+    return *domain;
+}
+
+EpochDomain::EpochDomain()
+    : epoch_(1)
+{}
+
+EpochDomain::Record& EpochDomain::record()
+{
+    if (threadRecord.record)
+        return *static_cast<Record*>(threadRecord.record);
+
+    std::lock_guard lock(mutex_);
+    Record* found = nullptr;
+    for (auto& candidate : records_) {
+        if (!candidate.used.load(std::memory_order_acquire)) {
+            found = &candidate;
+            break;
+        }
+    }
+    if (!found)
+        found = &records_.emplace_back();
+    found->used.store(true, std::memory_order_release);
+    found->depth = 0;
+    threadRecord.record = found;
+    threadRecord.used = &found->used;
+    return *found;
+}
+
+// The announced epoch has to be current after the fence: an older one read before a writer moved
+// the epoch on would not keep that writer from deleting what this reader is about to load
+void EpochDomain::enter()
+{
+    auto& current = record();
+    if (current.depth++ != 0)
+        return;
+
+    auto epoch = epoch_.load(std::memory_order_acquire);
+    while (true) {
+        current.epoch.store(epoch, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto now = epoch_.load(std::memory_order_acquire);
+        if (now == epoch)
+            break;
+        epoch = now;
+    }
+}
+
+void EpochDomain::exit()
+{
+    auto& current = *static_cast<Record*>(threadRecord.record);
+    if (--current.depth == 0)
+        current.epoch.store(0, std::memory_order_release);
+}
+
+void EpochDomain::retire(void* object, void (*deleter)(void*))
+{
+    std::lock_guard lock(mutex_);
+    retired_.push_back(Retired{ epoch_.load(std::memory_order_relaxed), object, deleter });
+}
+
+void EpochDomain::collect()
+{
+    std::vector<Retired> ready;
+    {
+        std::lock_guard lock(mutex_);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto epoch = epoch_.load(std::memory_order_relaxed);
+        bool caughtUp = true;
+        for (const auto& candidate : records_) {
+            auto pinned = candidate.epoch.load(std::memory_order_acquire);
+            if (pinned != 0 && pinned != epoch) {
+                caughtUp = false;
+                break;
+            }
+        }
+        if (caughtUp)
+            epoch_.store(++epoch, std::memory_order_release);
+
+        // Readers pinned at epoch - 1 may still see what was retired then, not anything older
+        auto split = std::partition(retired_.begin(), retired_.end(),
+                                    [epoch](const Retired& retired) { return retired.epoch + 2 > epoch; });
+        ready.assign(split, retired_.end());
+        retired_.erase(split, retired_.end());
+    }
+
+    // Deleters run without the lock, they may retire more objects
+    for (const auto& retired : ready)
+        retired.deleter(retired.object);
+}
+
+uint64_t EpochDomain::epoch() const
+{
+    return epoch_.load(std::memory_order_acquire);
+}
+
+size_t EpochDomain::pending() const
+{
+    std::lock_guard lock(mutex_);
+    return retired_.size();
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+// Epoch-based reclamation for objects read without locks. A reader pins the current epoch in a
+// record of its own thread for as long as it uses such objects: pinning writes only that record,
+// so readers on different cores share no cache line. A writer unlinks an object and retires it
+// instead of deleting it, the object is deleted once every pinned reader has moved two epochs on.
+// One domain serves the whole process.
+class EpochDomain {
+public:
+    class Guard {
+    public:
+        explicit Guard(EpochDomain& domain);
+        ~Guard();
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+    private:
+        EpochDomain& domain_;
+    };
+
+    static EpochDomain& instance();
+
+    // Pins may nest, the outermost one decides
+    Guard pin()
+    {
+        return Guard(*this);
+    }
+
+    // Only queues the object: retiring is done under the writer's locks, deleting is left to collect()
+    template <typename T>
+    void retire(T* object)
+    {
+        retire(object, [](void* pointer) { delete static_cast<T*>(pointer); });
+    }
+    void retire(void* object, void (*deleter)(void*));
+
+    // Advances the epoch if every pinned reader has caught up, and deletes what no reader can see.
+    // Meant to be called periodically, with no lock held that a deleter could need.
+    void collect();
+
+    uint64_t epoch() const;
+    size_t pending() const;
+
+private:
+    // Its own cache line, only its thread writes it
+    struct alignas(64) Record {
+        std::atomic<uint64_t> epoch{0}; // 0: not pinned
+        std::atomic_bool used{false};
+        uint32_t depth = 0;
+    };
+
+    struct Retired {
+        uint64_t epoch;
+        void* object;
+        void (*deleter)(void*);
+    };
+
+    EpochDomain();
+
+    Record& record();
+    void enter();
+    void exit();
+
+    std::atomic<uint64_t> epoch_;
+
+    mutable std::mutex mutex_;
+    std::deque<Record> records_;
+    std::vector<Retired> retired_;
+};
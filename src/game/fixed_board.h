@@ -0,0 +1,192 @@
+#pragma once
+
+#include "board.h"
+
+#include <array>
+#include <cstdint>
+#include <type_traits>
+
+// A bit per cell in the narrowest words that hold them: one uint16_t for 3x3, four uint64_t for 15x15
+template <int Bits>
+class CellSet {
+public:
+    using Word = std::conditional_t<Bits <= 16, uint16_t, std::conditional_t<Bits <= 32, uint32_t, uint64_t>>;
+    static constexpr int WORD_BITS = sizeof(Word) * 8;
+    static constexpr int WORDS = (Bits + WORD_BITS - 1) / WORD_BITS;
+
+    constexpr bool test(int cell) const
+    {
+        return (words_[cell / WORD_BITS] >> (cell % WORD_BITS)) & 1;
+    }
+
+    constexpr void set(int cell)
+    {
+        words_[cell / WORD_BITS] |= static_cast<Word>(Word(1) << (cell % WORD_BITS));
+    }
+
+    constexpr Word word(int index = 0) const
+    {
+        return words_[index];
+    }
+
+private:
+    std::array<Word, WORDS> words_{};
+};
+
+// Board with the size and win length fixed at compile time. Everything about the lines through a
+// cell is computed by the compiler, so a move only tests the bits that can complete a line.
+template <int N, int K>
+class FixedBoard final : public Board {
+    static_assert(N >= BoardRules::MIN_SIZE && N <= BoardRules::MAX_SIZE && K >= BoardRules::MIN_SIZE && K <= N);
+
+public:
+    static constexpr int CELLS = N * N;
+    using Cells = CellSet<CELLS>;
+    using Word = typename Cells::Word;
+
+    // Boards that fit a single word match whole lines with one AND each
+    static constexpr bool SINGLE_WORD = Cells::WORDS == 1;
+
+    bool isFree(int x, int y) const override
+    {
+        if (x < 0 || x >= N || y < 0 || y >= N)
+            return false;
+        int cell = x * N + y;
+        return !sides_[0].test(cell) && !sides_[1].test(cell);
+    }
+
+    bool place(int side, int x, int y) override
+    {
+        int cell = x * N + y;
+        sides_[side].set(cell);
+        ++moves_;
+        return completesLine(sides_[side], cell);
+    }
+
+    bool isFull() const override
+    {
+        return moves_ == CELLS;
+    }
+
+    int size() const override
+    {
+        return N;
+    }
+
+    std::unique_ptr<Board> clone() const override
+    {
+        return std::make_unique<FixedBoard>(*this);
+    }
+
+    void restore(const Board& other) override
+    {
+        *this = static_cast<const FixedBoard&>(other);
+    }
+
+    // side: every cell of one side, bit x * N + y
+    static constexpr bool completesLine(Word side, int cell) requires SINGLE_WORD
+    {
+        const auto& lines = LINE_MASKS[cell];
+        for (int i = 0; i < lines.count; ++i) {
+            if ((side & lines.masks[i]) == lines.masks[i])
+                return true;
+        }
+        return false;
+    }
+
+    static constexpr bool completesLine(const Cells& side, int cell)
+    {
+        if constexpr (SINGLE_WORD) {
+            return completesLine(side.word(), cell);
+        } else {
+            const auto& reach = REACH[cell];
+            for (int direction = 0; direction < 4; ++direction) {
+                auto [dx, dy] = DIRECTIONS[direction];
+                int step = dx * N + dy;
+                int count = 1;
+                for (int i = 1; i <= reach[direction * 2] && side.test(cell + i * step); ++i)
+                    ++count;
+                for (int i = 1; i <= reach[direction * 2 + 1] && side.test(cell - i * step); ++i)
+                    ++count;
+                if (count >= K)
+                    return true;
+            }
+            return false;
+        }
+    }
+
+private:
+    static constexpr std::array<std::pair<int, int>, 4> DIRECTIONS = {{ {1, 0}, {0, 1}, {1, 1}, {1, -1} }};
+
+    static constexpr bool inside(int x, int y)
+    {
+        return x >= 0 && x < N && y >= 0 && y < N;
+    }
+
+    // Every K-cell line through the cell, as masks
+    struct LineMasks {
+        std::array<Word, 4 * K> masks{};
+        int count = 0;
+    };
+
+    static constexpr std::array<LineMasks, CELLS> makeLineMasks()
+    {
+        std::array<LineMasks, CELLS> table{};
+        for (int x = 0; x < N; ++x) {
+            for (int y = 0; y < N; ++y) {
+                auto& lines = table[x * N + y];
+                for (auto [dx, dy] : DIRECTIONS) {
+                    for (int shift = 0; shift < K; ++shift) {
+                        int startX = x - shift * dx;
+                        int startY = y - shift * dy;
+                        if (!inside(startX, startY) || !inside(startX + (K - 1) * dx, startY + (K - 1) * dy))
+                            continue;
+                        Word mask = 0;
+                        for (int i = 0; i < K; ++i)
+                            mask |= static_cast<Word>(Word(1) << ((startX + i * dx) * N + startY + i * dy));
+                        lines.masks[lines.count++] = mask;
+                    }
+                }
+            }
+        }
+        return table;
+    }
+
+    // How many cells a run can extend from the cell in each direction and back, at most K - 1
+    static constexpr std::array<std::array<uint8_t, 8>, CELLS> makeReach()
+    {
+        std::array<std::array<uint8_t, 8>, CELLS> table{};
+        for (int x = 0; x < N; ++x) {
+            for (int y = 0; y < N; ++y) {
+                for (int direction = 0; direction < 4; ++direction) {
+                    auto [dx, dy] = DIRECTIONS[direction];
+                    for (int sign = 0; sign < 2; ++sign) {
+                        int d = sign == 0 ? 1 : -1;
+                        uint8_t reach = 0;
+                        while (reach < K - 1 && inside(x + (reach + 1) * dx * d, y + (reach + 1) * dy * d))
+                            ++reach;
+                        table[x * N + y][direction * 2 + sign] = reach;
+                    }
+                }
+            }
+        }
+        return table;
+    }
+
+    // Only the table the board size uses is generated
+    static constexpr auto LINE_MASKS = [] {
+        if constexpr (SINGLE_WORD)
+            return makeLineMasks();
+        else
+            return 0;
+    }();
+    static constexpr auto REACH = [] {
+        if constexpr (SINGLE_WORD)
+            return 0;
+        else
+            return makeReach();
+    }();
+
+    std::array<Cells, 2> sides_{};
+    uint16_t moves_ = 0;
+};
@@ -1,14 +1,22 @@
 #include "game.h"
 
-#include <boost/format.hpp>
+#include <bit>
 
-Game::Game(Id gameId)
+Game::Game(Id gameId, BoardRules rules, bool lockFree, std::shared_ptr<LockStats> lockStats, bool rated)
     : id_(gameId)
     , player1_(nullptr)
     , player2_(nullptr)
     , isOver_(false)
+    , rules_(rules)
+    , createdAt_(std::chrono::steady_clock::now())
+    , lockFree_(lockFree && rules.isClassic())
+    , rated_(rated)
+    , state_(0)
+    , announcedMoves_(0)
+    , lockStats_(std::move(lockStats))
 {
-    board_.fill({Cell::None, Cell::None, Cell::None });
+    if (!lockFree_ && !rules.isClassic())
+        board_ = makeBoard(rules);
 }
 
 Game::~Game()
@@ -21,11 +29,26 @@ const Id& Game::id() const
     return id_;
 }
 
+const BoardRules& Game::rules() const
+{
+    return rules_;
+}
+
 bool Game::isOver() const
 {
     return isOver_;
 }
 
+bool Game::isRated() const
+{
+    return rated_;
+}
+
+std::chrono::steady_clock::time_point Game::createdAt() const
+{
+    return createdAt_;
+}
+
 std::shared_ptr<Player> Game::player1() const
 {
     return player1_;
@@ -38,7 +61,9 @@ std::shared_ptr<Player> Game::player2() const
 
 bool Game::join(std::shared_ptr<Player> player)
 {
-    std::lock_guard lock(gameMutex_);
+    auto lock = lockCounted<std::unique_lock<std::mutex>>(gameMutex_, lockStats_.get());
+    if (isOver_)
+        return false;
     if (player1_ == nullptr) {
         player1_ = player;
         curPlayerId_ = player->id();
@@ -46,6 +71,8 @@ bool Game::join(std::shared_ptr<Player> player)
         if (player1_ == player)
             return false;
         player2_ = player;
+        // Publishes the players to makeMoveLockFree
+        state_.fetch_or(STARTED, std::memory_order_release);
         player1_->notify(Notification {
             .type = Notification::Type::PlayerJoined,
             .playerNickname = player->nickname(),
@@ -59,13 +86,23 @@ bool Game::join(std::shared_ptr<Player> player)
 }
 
 bool Game::leave(std::shared_ptr<Player> player) {
-    std::lock_guard lock(gameMutex_);
+    auto lock = lockCounted<std::unique_lock<std::mutex>>(gameMutex_, lockStats_.get());
     if (isOver_ || (player1_ != player && player2_ != player))
         return false;
 
     if (player1_ != nullptr && player2_ != nullptr) {
+        // A lock-free move may have finished the game in the meantime. Otherwise the moves already
+        // committed are announced before the opponent learns that the game is over.
+        if (lockFree_) {
+            auto state = state_.fetch_or(OVER, std::memory_order_acq_rel);
+            if (state & OVER)
+                return false;
+            awaitAnnounced(static_cast<uint32_t>(std::popcount(state & (CELLS_MASK | CELLS_MASK << O_SHIFT))));
+        }
+
         auto winner = (player == player1_) ? player2_ : player1_;
         winnerId = winner->id();
+        updateRatings();
         winner->notify(Notification{
             .type = Notification::Type::PlayerLeft,
             .playerNickname = player->nickname(),
@@ -86,25 +123,33 @@ bool Game::leave(std::shared_ptr<Player> player) {
 
 bool Game::makeMove(Id playerId, int x, int y)
 {
-    std::lock_guard lock(gameMutex_);
+    if (lockFree_)
+        return makeMoveLockFree(playerId, x, y);
+
+    auto lock = lockCounted<std::unique_lock<std::mutex>>(gameMutex_, lockStats_.get());
 
     if (isOver_ || player1_ == nullptr || player2_ == nullptr || playerId != curPlayerId_ || !isValidMove(x, y)) {
         return false;
     }
 
-    board_[x][y] = getCurCell();
+    auto cell = getCurCell();
+    int side = cell == Cell::X ? 0 : 1;
+    bool won = board_ ? board_->place(side, x, y) : classicBoard_.place(side, x, y);
     Notification notification {
         .type = Notification::Type::PlayerMoved,
         .playerNickname = (player1_->id() == playerId) ? player1_->nickname() : player2_->nickname(),
-        .extraInfo = (boost::format("%d %d %s") % x % y % (board_[x][y] == Cell::X ? 'X' : 'O')).str()
+        .x = x,
+        .y = y,
+        .mark = cell == Cell::X ? 'X' : 'O',
     };
     player1_->notify(notification);
     player2_->notify(notification);
 
-    auto gameStatus = checkFinish();
+    auto gameStatus = checkFinish(cell, won);
     if (gameStatus) {
         if (gameStatus != Cell::None)
             winnerId = (gameStatus == Cell::X) ? player1_->id() : player2_->id();
+        updateRatings();
         endGame();
     } else {
         switchPlayer();
@@ -114,7 +159,7 @@ bool Game::makeMove(Id playerId, int x, int y)
 
 bool Game::isValidMove(int x, int y) const
 {
-    return x >= 0 && x < 3 && y >= 0 && y < 3 && board_[x][y] == Cell::None;
+    return board_ ? board_->isFree(x, y) : classicBoard_.isFree(x, y);
 }
 
 Game::Cell Game::getCurCell() const
@@ -127,21 +172,24 @@ void Game::switchPlayer()
     curPlayerId_ = (curPlayerId_ == player1_->id()) ? player2_->id() : player1_->id();
 }
 
-std::optional<Game::Cell> Game::checkFinish() const
+// Only the line through the last move can have been completed, the board tells that on place()
+std::optional<Game::Cell> Game::checkFinish(Cell cell, bool won) const
 {
-    bool boardFull = true;
-    for (int i = 0; i < 3; ++i) {
-        if (board_[i][0] != Cell::None && board_[i][0] == board_[i][1] && board_[i][0] == board_[i][2]) return board_[i][0];
-        if (board_[0][i] != Cell::None && board_[0][i] == board_[1][i] && board_[0][i] == board_[2][i]) return board_[0][i];
-        for (int j = 0; j < 3; ++j) {
-            if (board_[i][j] == Cell::None) boardFull = false;
-        }
-    }
+    if (won)
+        return cell;
 
-    if (board_[0][0] != Cell::None && board_[0][0] == board_[1][1] && board_[0][0] == board_[2][2]) return board_[0][0];
-    if (board_[0][2] != Cell::None && board_[0][2] == board_[1][1] && board_[0][2] == board_[2][0]) return board_[0][2];
+    bool full = board_ ? board_->isFull() : classicBoard_.isFull();
+    return full ? std::make_optional(Cell::None) : std::nullopt;
+}
 
-    return boardFull ? std::make_optional(Cell::None) : std::nullopt;
+bool Game::closeIfEmpty()
+{
+    auto lock = lockCounted<std::unique_lock<std::mutex>>(gameMutex_, lockStats_.get());
+    if (isOver_ || player1_ || player2_)
+        return false;
+    state_.fetch_or(OVER, std::memory_order_relaxed);
+    isOver_ = true;
+    return true;
 }
 
 void Game::endGame()
@@ -167,3 +215,86 @@ void Game::endGame()
         player2_->notify(notification);
     }
 }
+
+void Game::updateRatings()
+{
+    if (!rated_ || player1_->isBot() || player2_->isBot())
+        return;
+    double score1 = winnerId ? (*winnerId == player1_->id() ? 1.0 : 0.0) : 0.5;
+    double rating1 = player1_->rating();
+    double rating2 = player2_->rating();
+    player1_->setRating(updatedRating(rating1, rating2, score1));
+    player2_->setRating(updatedRating(rating2, rating1, 1.0 - score1));
+}
+
+// The move is committed with a single CAS on state_, then the notifications go out without any
+// lock held. A player may move as soon as the commit lands, before being notified, so the next
+// move's notifications wait for this move's ones: every player sees the moves in order.
+bool Game::makeMoveLockFree(Id playerId, int x, int y)
+{
+    if (x < 0 || x >= 3 || y < 0 || y >= 3)
+        return false;
+
+    int cell = x * 3 + y;
+    uint64_t state = state_.load(std::memory_order_acquire);
+    uint64_t next;
+    int side;
+    bool won;
+    bool full;
+    uint32_t moves;
+    do {
+        if (!(state & STARTED) || (state & OVER))
+            return false;
+
+        side = (state & O_TO_MOVE) ? 1 : 0;
+        if (playerId != (side == 0 ? player1_ : player2_)->id())
+            return false;
+
+        uint64_t xCells = state & CELLS_MASK;
+        uint64_t oCells = (state >> O_SHIFT) & CELLS_MASK;
+        if ((xCells | oCells) & (uint64_t(1) << cell))
+            return false;
+
+        uint64_t sideCells = (side == 0 ? xCells : oCells) | (uint64_t(1) << cell);
+        won = FixedBoard<3, 3>::completesLine(static_cast<uint16_t>(sideCells), cell);
+        moves = static_cast<uint32_t>(std::popcount(xCells | oCells));
+        full = moves == 8;
+
+        next = state | (uint64_t(1) << (cell + side * O_SHIFT));
+        next = (won || full) ? next | OVER : next ^ O_TO_MOVE;
+    } while (!state_.compare_exchange_weak(state, next, std::memory_order_acq_rel, std::memory_order_acquire));
+
+    awaitAnnounced(moves);
+    const auto& mover = side == 0 ? player1_ : player2_;
+    Notification notification {
+        .type = Notification::Type::PlayerMoved,
+        .playerNickname = mover->nickname(),
+        .x = x,
+        .y = y,
+        .mark = side == 0 ? 'X' : 'O',
+    };
+    player1_->notify(notification);
+    player2_->notify(notification);
+
+    if (won || full) {
+        if (won)
+            winnerId = mover->id();
+        updateRatings();
+        endGame();
+    }
+    finishAnnounced(moves);
+    return true;
+}
+
+void Game::awaitAnnounced(uint32_t moves) const
+{
+    for (auto announced = announcedMoves_.load(std::memory_order_acquire); announced != moves;
+         announced = announcedMoves_.load(std::memory_order_acquire))
+        announcedMoves_.wait(announced, std::memory_order_acquire);
+}
+
+void Game::finishAnnounced(uint32_t moves)
+{
+    announcedMoves_.store(moves + 1, std::memory_order_release);
+    announcedMoves_.notify_all();
+}
@@ -2,9 +2,12 @@
 
 #include "player.h"
 #include "common.h"
+#include "fixed_board.h"
+#include "lock_stats.h"
 
 #include <array>
 #include <atomic>
+#include <chrono>
 #include <string>
 #include <mutex>
 
@@ -12,11 +15,18 @@ class Game {
 public:
     enum Cell { None, X, O, };
 
-    explicit Game(Id gameId);
+    // lockFree only applies to the classic board, see makeMoveLockFree.
+    // lockStats, if any, collects the waits for the game mutex.
+    // rated: the result updates the players' ratings, unless one of them is a bot.
+    explicit Game(Id gameId, BoardRules rules = {}, bool lockFree = false,
+                  std::shared_ptr<LockStats> lockStats = nullptr, bool rated = false);
     ~Game();
 
     const Id& id() const;
+    const BoardRules& rules() const;
     bool isOver() const;
+    bool isRated() const;
+    std::chrono::steady_clock::time_point createdAt() const;
 
     std::shared_ptr<Player> player1() const;
     std::shared_ptr<Player> player2() const;
@@ -24,6 +34,8 @@ public:
     bool join(std::shared_ptr<Player> player);
     bool leave(std::shared_ptr<Player> player);
     bool makeMove(Id playerId, int x, int y);
+    // Ends a game nobody has joined, so that nobody can join it any more
+    bool closeIfEmpty();
 
 private:
     bool isValidMove(int x, int y) const;
@@ -31,8 +43,23 @@ private:
 
     void switchPlayer();
 
-    std::optional<Cell> checkFinish() const;
+    std::optional<Cell> checkFinish(Cell cell, bool won) const;
     void endGame();
+    // A rated game updates the ratings once it is decided, by its last move or by a player leaving
+    void updateRatings();
+
+    bool makeMoveLockFree(Id playerId, int x, int y);
+    // Lock-free moves are announced in commit order: the announcement of the moves-th move waits
+    // for the ones before it
+    void awaitAnnounced(uint32_t moves) const;
+    void finishAnnounced(uint32_t moves);
+
+    // Lock-free mode keeps the whole mutable state of a 3x3 game in one word
+    static constexpr int O_SHIFT = 9;
+    static constexpr uint64_t CELLS_MASK = 0x1ff;
+    static constexpr uint64_t O_TO_MOVE = uint64_t(1) << 18;
+    static constexpr uint64_t STARTED = uint64_t(1) << 19; // both players joined, players are fixed
+    static constexpr uint64_t OVER = uint64_t(1) << 20;
 
     Id id_;
     std::shared_ptr<Player> player1_;
@@ -41,7 +68,18 @@ private:
     std::optional<Id> winnerId;
 
     std::atomic_bool isOver_;
-    std::array<std::array<Cell, 3>, 3> board_{};
+    BoardRules rules_;
+    // The classic board is called directly, other boards through Board. Lock-free games use neither.
+    FixedBoard<3, 3> classicBoard_;
+    std::unique_ptr<Board> board_;
+    std::chrono::steady_clock::time_point createdAt_;
+
+    bool lockFree_;
+    bool rated_;
+    std::atomic<uint64_t> state_;
+    // Lock-free moves whose notifications have gone out
+    std::atomic<uint32_t> announcedMoves_;
 
+    std::shared_ptr<LockStats> lockStats_;
     mutable std::mutex gameMutex_;
 };
\ No newline at end of file
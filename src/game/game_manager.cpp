@@ -1,15 +1,41 @@
 #include "game_manager.h"
+#include "epoch.h"
 
 #include <algorithm>
 
-const Id& GameManager::createGame()
+GameManager::GameManager(bool lockFreeMoves, size_t shardCount, size_t matchQueueCapacity, RatingWindow ratingWindow,
+                         bool epochReads)
+    : shards_(std::max<size_t>(shardCount, 1))
+    , gameLockStats_(std::make_shared<LockStats>())
+    , gamePool_(std::make_shared<GamePool>(GAME_POOL_CAPACITY))
+    , matchQueue_(matchQueueCapacity)
+    , waitingTicket_(nullptr)
+    , ratingPool_(ratingWindow)
+    , nextShard_(0)
+    , lobbyVersion_(0)
+    , lockFreeMoves_(lockFreeMoves)
+    , epochReads_(epochReads)
 {
-    std::unique_lock lock(mutex_);
-    auto gameId = getNewId();
-    auto game = std::make_shared<Game>(gameId);
-    games_.emplace(gameId, game);
+    for (size_t i = 0; i < shards_.size(); ++i)
+        shards_[i].games = GameSlab(i, shards_.size(), epochReads);
+}
+
+GameManager::~GameManager()
+{
+    delete waitingTicket_.load(std::memory_order_acquire);
+}
+
+Id GameManager::createGame(BoardRules rules)
+{
+    // The game is built between taking its slot and publishing it, without the shard lock
+    auto [target, gameId] = reserveGame();
+    if (gameId == INVALID_GAME_ID)
+        return INVALID_GAME_ID;
+    auto game = makeGame(gameId, rules);
+    auto lock = lockCounted<std::unique_lock<std::shared_mutex>>(target->mutex, &target->lockStats);
+    target->games.set(gameId, std::move(game));
 
-    return game->id();
+    return gameId;
 }
 
 bool GameManager::addPlayerToGame(std::shared_ptr<Player> player, const Id& gameId)
@@ -22,68 +48,346 @@ bool GameManager::addPlayerToGame(std::shared_ptr<Player> player, const Id& game
         return false;
 
     bool result = game->join(player);
+    if (result)
+        updateWaiting(game);
 
     return result;
 }
 
-bool GameManager::leavePlayerFromGame(std::shared_ptr<Player> player)
+// Writers on the shard don't queue behind the game logic: the lock is held for the lookup only
+template <typename F>
+auto GameManager::withGame(const Id& gameId, F&& f) const
 {
-    if (!player->isInGame())
-        return false;
+    if (epochReads_) {
+        auto pin = EpochDomain::instance().pin();
+        auto* game = shard(gameId).games.lookup(gameId);
+        return f(game ? game->get() : nullptr);
+    }
+    auto game = getGame(gameId);
+    return f(game.get());
+}
 
-    auto game = getGame(*player->curGameId());
-    if (!game)
+bool GameManager::leavePlayerFromGame(std::shared_ptr<Player> player)
+{
+    auto gameId = player->curGameId();
+    if (!gameId)
         return false;
 
-    bool result = game->leave(player);
+    bool result = withGame(*gameId, [&player](Game* game) { return game && game->leave(player); });
     if (result)
-        removeGame(game->id());
+        removeGame(*gameId);
 
     return result;
 }
 
 bool GameManager::makeMove(std::shared_ptr<Player> player, int x, int y)
 {
-    if (!player->isInGame())
+    auto gameId = player->curGameId();
+    if (!gameId)
         return false;
 
-    auto game = getGame(*player->curGameId());
-    if (!game)
-        return false;
+    bool result = false;
+    bool over = false;
+    withGame(*gameId, [&](Game* game)
+        {
+            if (!game)
+                return;
+            result = game->makeMove(player->id(), x, y);
+            over = result && game->isOver();
+        });
+    if (over)
+        removeGame(*gameId);
 
-    bool result = game->makeMove(player->id(), x, y);
+    return result;
+}
 
-    if (result && game->isOver()) {
-        removeGame(game->id());
+std::optional<GameManager::QuickMatch> GameManager::quickMatch(std::shared_ptr<Player> player)
+{
+    if (player->isInGame())
+        return std::nullopt;
+
+    // Tickets that came back from a full registry waited longest. Tickets of players that left,
+    // gave up or got into a game since are thrown away.
+    while (auto ticket = matchQueue_.pop()) {
+        if (auto gameId = pairWithTicket(std::move(*ticket), player))
+            return *gameId != INVALID_GAME_ID ? std::make_optional<QuickMatch>(*gameId) : std::nullopt;
     }
 
-    return result;
+    // Every other player waits in the slot. Taking the ticket there and putting one in are single
+    // CASes, so of two players arriving together one always finds the other.
+    auto ticket = std::make_shared<MatchTicket>(player);
+    while (true) {
+        if (auto* waiting = waitingTicket_.exchange(nullptr, std::memory_order_acq_rel)) {
+            auto opponentTicket = std::move(*waiting);
+            delete waiting;
+            if (auto gameId = pairWithTicket(std::move(opponentTicket), player))
+                return *gameId != INVALID_GAME_ID ? std::make_optional<QuickMatch>(*gameId) : std::nullopt;
+            continue;
+        }
+        auto* waiting = new std::shared_ptr<MatchTicket>(ticket);
+        std::shared_ptr<MatchTicket>* expected = nullptr;
+        if (waitingTicket_.compare_exchange_strong(expected, waiting, std::memory_order_acq_rel))
+            return ticket;
+        delete waiting;
+    }
 }
 
-std::vector<std::shared_ptr<Game>> GameManager::getWaitingGames() const
+std::optional<Id> GameManager::pairWithTicket(std::shared_ptr<MatchTicket> ticket, const std::shared_ptr<Player>& player)
 {
-    std::shared_lock lock(mutex_);
-    std::vector<std::shared_ptr<Game>> result;
-    for (const auto& [_, game] : games_) {
-        if (!game->isOver() && game->player1() && !game->player2()) {
-            result.push_back(game);
+    auto opponent = ticket->player();
+    if (!opponent || opponent == player || opponent->isInGame() || !ticket->claim())
+        return std::nullopt;
+    auto gameId = createMatchedGame(std::move(opponent), player, false);
+    if (gameId == INVALID_GAME_ID) {
+        ticket->release();
+        matchQueue_.push(std::move(ticket));
+        return INVALID_GAME_ID;
+    }
+    ticket->finishPairing();
+    return gameId;
+}
+
+std::optional<GameManager::QuickMatch> GameManager::ratedMatch(std::shared_ptr<Player> player,
+                                                               RatingPool::Clock::time_point now)
+{
+    if (player->isInGame())
+        return std::nullopt;
+
+    if (auto match = ratingPool_.take(player, now)) {
+        auto gameId = createMatchedGame(match->player, std::move(player), true);
+        if (gameId == INVALID_GAME_ID) {
+            match->ticket->release();
+            return std::nullopt;
         }
+        match->ticket->finishPairing();
+        return gameId;
+    }
+
+    auto ticket = std::make_shared<MatchTicket>(player);
+    ratingPool_.add(ticket, player->rating(), now);
+    return ticket;
+}
+
+std::vector<Id> GameManager::matchRatedPlayers(RatingPool::Clock::time_point now)
+{
+    std::vector<Id> gameIds;
+    ratingPool_.matchWaiting(now, [this, &gameIds](RatingPool::Match first, RatingPool::Match second)
+        {
+            auto gameId = createMatchedGame(first.player, second.player, true, true);
+            if (gameId == INVALID_GAME_ID) {
+                first.ticket->release();
+                second.ticket->release();
+                return;
+            }
+            gameIds.push_back(gameId);
+            first.ticket->finishPairing();
+            second.ticket->finishPairing();
+        });
+    return gameIds;
+}
+
+const RatingPool& GameManager::ratingPool() const
+{
+    return ratingPool_;
+}
+
+std::vector<std::shared_ptr<Game>> GameManager::getWaitingGames(size_t limit, std::optional<Id> after) const
+{
+    using Games = std::vector<std::shared_ptr<Game>>;
+    using Range = std::pair<Games::const_iterator, Games::const_iterator>;
+
+    // The shards are visited one at a time: each gives its first limit games after the cursor,
+    // which are merged in id order once no lock is held
+    std::vector<Games> pages;
+    pages.reserve(shards_.size());
+    for (const auto& shard : shards_) {
+        auto lock = lockCounted<std::shared_lock<std::shared_mutex>>(shard.mutex, &shard.lockStats);
+        auto begin = after ? shard.waiting.upper_bound(*after) : shard.waiting.begin();
+        Games page;
+        for (auto it = begin; it != shard.waiting.end() && page.size() < limit; ++it)
+            page.push_back(it->second);
+        if (!page.empty())
+            pages.push_back(std::move(page));
+    }
+
+    std::vector<Range> ranges;
+    ranges.reserve(pages.size());
+    for (const auto& page : pages)
+        ranges.emplace_back(page.begin(), page.end());
+
+    auto later = [](const Range& lhs, const Range& rhs) { return (*lhs.first)->id() > (*rhs.first)->id(); };
+    std::make_heap(ranges.begin(), ranges.end(), later);
+
+    std::vector<std::shared_ptr<Game>> result;
+    while (!ranges.empty() && result.size() < limit) {
+        std::pop_heap(ranges.begin(), ranges.end(), later);
+        auto& range = ranges.back();
+        result.push_back(*range.first);
+        if (++range.first == range.second)
+            ranges.pop_back();
+        else
+            std::push_heap(ranges.begin(), ranges.end(), later);
     }
     return result;
 }
 
-std::shared_ptr<Game> GameManager::getGame(const Id& gameId) const
+uint64_t GameManager::lobbyVersion() const
 {
-    std::shared_lock lock(mutex_);
-    auto it = games_.find(gameId);
-    if (it == games_.end())
-        return nullptr;
+    return lobbyVersion_.load(std::memory_order_acquire);
+}
 
-    return it->second;
+std::shared_ptr<Game> GameManager::getGame(const Id& gameId) const
+{
+    const auto& source = shard(gameId);
+    if (epochReads_) {
+        auto pin = EpochDomain::instance().pin();
+        auto game = source.games.lookup(gameId);
+        return game ? *game : nullptr;
+    }
+    auto lock = lockCounted<std::shared_lock<std::shared_mutex>>(source.mutex, &source.lockStats);
+    auto game = source.games.find(gameId);
+    return game ? *game : nullptr;
 }
 
 void GameManager::removeGame(const Id& gameId)
 {
-    std::unique_lock lock(mutex_);
-    games_.erase(gameId);
+    auto& target = shard(gameId);
+    std::shared_ptr<Game> game;
+    {
+        auto lock = lockCounted<std::unique_lock<std::shared_mutex>>(target.mutex, &target.lockStats);
+        if (!target.games.find(gameId))
+            return;
+        game = target.games.release(gameId);
+        if (target.waiting.erase(gameId))
+            lobbyVersion_.fetch_add(1, std::memory_order_release);
+    }
+    // The last reference may go here, the game is destroyed outside the shard lock
+}
+
+GameManager::Reaped GameManager::reapGames(size_t budget, std::chrono::steady_clock::duration emptyGrace,
+                                           std::chrono::steady_clock::time_point now)
+{
+    std::lock_guard reapLock(reapMutex_);
+    Reaped reaped;
+    // Every shard is visited at most once per call, even if most of them are empty
+    for (size_t shards = 0; reaped.visited < budget && shards < shards_.size();) {
+        auto& target = shards_[reapShard_];
+        auto slice = std::min(budget - reaped.visited, REAP_SLICE);
+        std::vector<std::shared_ptr<Game>> garbage;
+        {
+            auto lock = lockCounted<std::unique_lock<std::shared_mutex>>(target.mutex, &target.lockStats);
+            std::vector<Id> doomed;
+            auto next = target.games.visit(reapSlot_, slice, [&](Id gameId, const std::shared_ptr<Game>& game)
+                {
+                    if (game->isOver()) {
+                        ++reaped.over;
+                        doomed.push_back(gameId);
+                    } else if (now - game->createdAt() >= emptyGrace && game->closeIfEmpty()) {
+                        ++reaped.empty;
+                        doomed.push_back(gameId);
+                    }
+                });
+            reaped.visited += (next ? next : std::max(target.games.slotCount(), reapSlot_)) - reapSlot_;
+            for (auto gameId : doomed) {
+                garbage.push_back(target.games.release(gameId));
+                if (target.waiting.erase(gameId))
+                    lobbyVersion_.fetch_add(1, std::memory_order_release);
+            }
+            reapSlot_ = next;
+        }
+        // Games are destroyed outside the shard lock
+        garbage.clear();
+        if (reapSlot_ == 0) {
+            reapShard_ = (reapShard_ + 1) % shards_.size();
+            ++shards;
+        }
+    }
+    // What the slabs retired is freed here, outside every shard lock
+    if (epochReads_)
+        EpochDomain::instance().collect();
+    return reaped;
+}
+
+size_t GameManager::shardCount() const
+{
+    return shards_.size();
+}
+
+const LockStats& GameManager::shardLockStats(size_t shard) const
+{
+    return shards_[shard].lockStats;
+}
+
+const LockStats& GameManager::gameLockStats() const
+{
+    return *gameLockStats_;
+}
+
+// The slot index in the handle tells the shard that owns it
+GameManager::Shard& GameManager::shard(const Id& gameId)
+{
+    return shards_[GameSlab::shardOf(gameId, shards_.size())];
+}
+
+const GameManager::Shard& GameManager::shard(const Id& gameId) const
+{
+    return shards_[GameSlab::shardOf(gameId, shards_.size())];
+}
+
+// Consecutive games land on different shards. A full shard passes the game on to the next one.
+std::pair<GameManager::Shard*, Id> GameManager::reserveGame()
+{
+    auto first = nextShard_.fetch_add(1, std::memory_order_relaxed);
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        auto& target = shards_[(first + i) % shards_.size()];
+        auto lock = lockCounted<std::unique_lock<std::shared_mutex>>(target.mutex, &target.lockStats);
+        auto gameId = target.games.reserve();
+        if (gameId != INVALID_GAME_ID)
+            return { &target, gameId };
+    }
+    return { nullptr, INVALID_GAME_ID };
+}
+
+// Joins of the same game may race, so the index follows the game's state at the time of the
+// update rather than the join that triggered it: the last update always sees the final state.
+void GameManager::updateWaiting(const std::shared_ptr<Game>& game)
+{
+    auto& target = shard(game->id());
+    auto lock = lockCounted<std::unique_lock<std::shared_mutex>>(target.mutex, &target.lockStats);
+    bool waiting = !game->isOver() && game->player1() && !game->player2() && target.games.get(game->id()) == game.get();
+    bool changed = waiting ? target.waiting.emplace(game->id(), game).second : target.waiting.erase(game->id()) != 0;
+    // Bumped under the shard lock, so a reader that saw the new version also sees the change
+    if (changed)
+        lobbyVersion_.fetch_add(1, std::memory_order_release);
+}
+
+// Both players join under the shard lock, so nobody can look the game up, let alone take a seat,
+// before it is full. It never enters the waiting index.
+Id GameManager::createMatchedGame(std::shared_ptr<Player> first, std::shared_ptr<Player> second, bool rated,
+                                  bool notifySecond)
+{
+    auto [target, gameId] = reserveGame();
+    if (gameId == INVALID_GAME_ID)
+        return INVALID_GAME_ID;
+    auto game = makeGame(gameId, BoardRules{}, rated);
+    auto lock = lockCounted<std::unique_lock<std::shared_mutex>>(target->mutex, &target->lockStats);
+    target->games.set(gameId, game);
+    // Before the first player is told of its opponent, so no move of it can reach the second player earlier
+    if (notifySecond) {
+        second->notify(Notification{
+            .type = Notification::Type::MatchFound,
+            .playerNickname = first->nickname(),
+            .gameId = gameId,
+        });
+    }
+    game->join(std::move(first));
+    game->join(std::move(second));
+
+    return gameId;
+}
+
+std::shared_ptr<Game> GameManager::makeGame(Id gameId, BoardRules rules, bool rated) const
+{
+    return std::allocate_shared<Game>(GamePoolAllocator<Game>(gamePool_), gameId, rules, lockFreeMoves_,
+                                      gameLockStats_, rated);
 }
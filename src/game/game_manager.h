@@ -2,33 +2,139 @@
 
 #include "game.h"
 #include "common.h"
+#include "game_pool.h"
+#include "game_slab.h"
+#include "match_ticket.h"
+#include "mpmc_queue.h"
+#include "rating_pool.h"
 
 #include <boost/uuid/random_generator.hpp>
 
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
 #include <shared_mutex>
-#include <unordered_map>
+#include <variant>
+#include <vector>
 #include <iostream>
 
 class GameManager {
 public:
-    const Id& createGame();
+    static constexpr size_t DEFAULT_SHARD_COUNT = 64;
+    static constexpr size_t DEFAULT_MATCH_QUEUE_CAPACITY = 1 << 16;
+    static constexpr Id INVALID_GAME_ID = GameSlab::INVALID_HANDLE;
+
+    // lockFreeMoves: classic games apply moves with a CAS instead of the game mutex.
+    // The registry is split by game id into shardCount independently locked maps.
+    // epochReads: games are looked up without the shard lock, pinned in the EpochDomain instead.
+    // Registering and removing games still takes it. Only then is the lookup of every MOVE and
+    // LEAVE free of atomic read-modify-writes: otherwise it takes the shard lock shared and copies
+    // the game's shared_ptr, the slab itself costs no atomics either way.
+    explicit GameManager(bool lockFreeMoves = false, size_t shardCount = DEFAULT_SHARD_COUNT,
+                         size_t matchQueueCapacity = DEFAULT_MATCH_QUEUE_CAPACITY, RatingWindow ratingWindow = {},
+                         bool epochReads = false);
+    ~GameManager();
+
+    // The id is a generation-tagged handle to a registry slot, see GameSlab.
+    // INVALID_GAME_ID if the registry is full.
+    Id createGame(BoardRules rules = {});
 
     bool addPlayerToGame(std::shared_ptr<Player> player, const Id& gameId);
     bool leavePlayerFromGame(std::shared_ptr<Player> player);
 
     bool makeMove(std::shared_ptr<Player> player, int x, int y);
-    std::vector<std::shared_ptr<Game>> getWaitingGames() const;
+
+    // The id of the classic game the player was paired into, or the ticket it waits with
+    using QuickMatch = std::variant<Id, std::shared_ptr<MatchTicket>>;
+    // Pairs the player with the longest waiting one: the game is registered with both seats taken
+    // and the waiting player moves first. With nobody to pair with the player is queued, the game
+    // is then made by whoever comes next: of the players that ask, at most one is left waiting.
+    // nullopt: the player is in a game or the registry is full.
+    std::optional<QuickMatch> quickMatch(std::shared_ptr<Player> player);
+
+    // Like quickMatch, but the opponent is the closest rated one within reach. A player nobody is
+    // within reach of waits in the rating pool until matchRatedPlayers pairs it.
+    std::optional<QuickMatch> ratedMatch(std::shared_ptr<Player> player,
+                                         RatingPool::Clock::time_point now = RatingPool::Clock::now());
+    // Pairs the waiting players whose windows have grown to reach each other, returns the games made.
+    // Meant to be called periodically.
+    std::vector<Id> matchRatedPlayers(RatingPool::Clock::time_point now = RatingPool::Clock::now());
+    const RatingPool& ratingPool() const;
+    // Games with one player and a free seat, in id order: at most limit of them with ids after
+    // the cursor. The id of the last game returned is the cursor of the next page.
+    std::vector<std::shared_ptr<Game>> getWaitingGames(size_t limit = SIZE_MAX, std::optional<Id> after = std::nullopt) const;
+    // Grows every time a game enters or leaves the waiting games. A lobby listed after reading
+    // the version is at least as new as that version.
+    uint64_t lobbyVersion() const;
 
     std::shared_ptr<Game> getGame(const Id& gameId) const;
     void removeGame(const Id& gameId);
+
+    struct Reaped {
+        size_t visited = 0;
+        size_t over = 0;
+        size_t empty = 0;
+    };
+    // Removes the games that are over but still registered, and the ones nobody joined within
+    // emptyGrace of their creation. Visits at most budget slots, going on where the last call
+    // stopped, and holds a shard lock for at most REAP_SLICE of them at a time. With epochReads it
+    // also frees the games retired from the slabs that no reader can see any more. Meant to be
+    // called periodically.
+    static constexpr size_t REAP_SLICE = 64;
+    Reaped reapGames(size_t budget, std::chrono::steady_clock::duration emptyGrace,
+                     std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+
+    // Waits for the mutex of one registry shard, and for the mutexes of every game created by this manager
+    size_t shardCount() const;
+    const LockStats& shardLockStats(size_t shard) const;
+    const LockStats& gameLockStats() const;
 private:
-    uint32_t getNewId()
-    {
-        return idCounter_++;
-    }
+    // A cache line each, so that neighbouring shards don't contend through their mutexes
+    struct alignas(64) Shard {
+        GameSlab games;
+        // The subset of games that can be joined, kept up to date on join and removal
+        std::map<Id, std::shared_ptr<Game>> waiting;
+        mutable std::shared_mutex mutex;
+        mutable LockStats lockStats;
+    };
+
+    Shard& shard(const Id& gameId);
+    const Shard& shard(const Id& gameId) const;
+    void updateWaiting(const std::shared_ptr<Game>& game);
+    // Calls f with the game, kept alive by a reference or the epoch pin, never by the shard lock.
+    // f(nullptr) for a game that is gone.
+    template <typename F>
+    auto withGame(const Id& gameId, F&& f) const;
+    // The ticket's player and the given one in a new game. nullopt if the ticket no longer waits,
+    // INVALID_GAME_ID if the registry is full: the ticket goes back to the match queue then.
+    std::optional<Id> pairWithTicket(std::shared_ptr<MatchTicket> ticket, const std::shared_ptr<Player>& player);
+    // rated: made by rated matchmaking, the result updates the ratings.
+    // notifySecond: the second player did not ask for this game just now and is told about it.
+    Id createMatchedGame(std::shared_ptr<Player> first, std::shared_ptr<Player> second, bool rated,
+                         bool notifySecond = false);
+    // Reserves a slot for a new game, shards take turns. Must be published with set() or released.
+    std::pair<Shard*, Id> reserveGame();
+    // The game's memory comes from the pool, and goes back to it when the last reference is dropped
+    std::shared_ptr<Game> makeGame(Id gameId, BoardRules rules, bool rated = false) const;
+
+    static constexpr size_t GAME_POOL_CAPACITY = 1 << 14;
 
-    std::unordered_map<Id, std::shared_ptr<Game>> games_;
-    mutable std::shared_mutex mutex_;
+    std::vector<Shard> shards_;
+    std::shared_ptr<LockStats> gameLockStats_;
+    std::shared_ptr<GamePool> gamePool_;
+    MpmcQueue<std::shared_ptr<MatchTicket>> matchQueue_;
+    // The one player waiting for a quick match, owned by the slot
+    std::atomic<std::shared_ptr<MatchTicket>*> waitingTicket_;
+    RatingPool ratingPool_;
 
-    std::atomic<uint32_t> idCounter_;
+    std::atomic<size_t> nextShard_;
+    // Where the reaper goes on from
+    std::mutex reapMutex_;
+    size_t reapShard_ = 0;
+    size_t reapSlot_ = 0;
+    std::atomic<uint64_t> lobbyVersion_;
+    bool lockFreeMoves_;
+    bool epochReads_;
 };
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "mpmc_queue.h"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+
+// Memory of finished games, handed to the next games instead of going back to the heap, so game
+// churn stops allocating once the pool is warm. A game and its reference counts are one block, see
+// GamePoolAllocator, and all games are one type, so any free block fits a new game: the pool keeps
+// blocks of the size it was first asked for, other sizes go straight to the heap.
+// Lock free, freed blocks wait in an MpmcQueue. Beyond its capacity they go back to the heap.
+class GamePool {
+public:
+    explicit GamePool(size_t capacity)
+        : free_(capacity)
+        , blockSize_(0)
+    {}
+
+    ~GamePool()
+    {
+        while (auto block = free_.pop())
+            ::operator delete(*block);
+    }
+
+    GamePool(const GamePool&) = delete;
+    GamePool& operator=(const GamePool&) = delete;
+
+    void* allocate(size_t size)
+    {
+        size_t expected = 0;
+        if (blockSize_.compare_exchange_strong(expected, size, std::memory_order_relaxed) || expected == size) {
+            if (auto block = free_.pop())
+                return *block;
+        }
+        return ::operator new(size);
+    }
+
+    void deallocate(void* block, size_t size)
+    {
+        if (size != blockSize_.load(std::memory_order_relaxed) || !free_.push(block))
+            ::operator delete(block);
+    }
+
+private:
+    MpmcQueue<void*> free_;
+    std::atomic<size_t> blockSize_;
+};
+
+// Allocates from a GamePool, for std::allocate_shared. Every game holds on to the pool through
+// its allocator, so the pool outlives the games, whoever releases them last.
+template <typename T>
+class GamePoolAllocator {
+public:
+    static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+
+    using value_type = T;
+
+    explicit GamePoolAllocator(std::shared_ptr<GamePool> pool)
+        : pool_(std::move(pool))
+    {}
+
+    template <typename U>
+    GamePoolAllocator(const GamePoolAllocator<U>& other)
+        : pool_(other.pool_)
+    {}
+
+    T* allocate(size_t n)
+    {
+        return static_cast<T*>(pool_->allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T* ptr, size_t n)
+    {
+        pool_->deallocate(ptr, n * sizeof(T));
+    }
+
+    template <typename U>
+    bool operator==(const GamePoolAllocator<U>& other) const
+    {
+        return pool_ == other.pool_;
+    }
+
+private:
+    template <typename U>
+    friend class GamePoolAllocator;
+
+    std::shared_ptr<GamePool> pool_;
+};
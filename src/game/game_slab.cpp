@@ -0,0 +1,187 @@
+#include "game_slab.h"
+#include "epoch.h"
+
+#include <utility>
+
+GameSlab::GameSlab(size_t shard, size_t shardCount, bool published)
+    : shard_(shard)
+    , shardCount_(shardCount)
+    // INDEX_MASK itself is left out, it is the index of INVALID_HANDLE
+    , capacity_((INDEX_MASK - shard + shardCount - 1) / shardCount)
+    , freeHead_(0)
+    , size_(0)
+{
+    if (published) {
+        auto chunkCount = (capacity_ + CHUNK_SIZE - 1) / CHUNK_SIZE;
+        chunks_ = std::make_unique<std::atomic<Chunk*>[]>(chunkCount);
+        for (size_t i = 0; i < chunkCount; ++i)
+            chunks_[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+GameSlab::~GameSlab()
+{
+    destroyPublished();
+}
+
+GameSlab::GameSlab(GameSlab&& other) noexcept
+    : shard_(other.shard_)
+    , shardCount_(other.shardCount_)
+    , capacity_(other.capacity_)
+    , slots_(std::move(other.slots_))
+    , free_(std::move(other.free_))
+    , freeHead_(other.freeHead_)
+    , size_(other.size_)
+    , chunks_(std::move(other.chunks_))
+{}
+
+GameSlab& GameSlab::operator=(GameSlab&& other) noexcept
+{
+    if (this != &other) {
+        destroyPublished();
+        shard_ = other.shard_;
+        shardCount_ = other.shardCount_;
+        capacity_ = other.capacity_;
+        slots_ = std::move(other.slots_);
+        free_ = std::move(other.free_);
+        freeHead_ = other.freeHead_;
+        size_ = other.size_;
+        chunks_ = std::move(other.chunks_);
+    }
+    return *this;
+}
+
+Id GameSlab::reserve()
+{
+    uint32_t local;
+    if (freeHead_ < free_.size()) {
+        local = free_[freeHead_++];
+        // The queue is compacted once its consumed half is the larger one
+        if (freeHead_ * 2 >= free_.size() && freeHead_ >= 64) {
+            free_.erase(free_.begin(), free_.begin() + static_cast<std::ptrdiff_t>(freeHead_));
+            freeHead_ = 0;
+        }
+    } else if (slots_.size() < capacity_) {
+        local = static_cast<uint32_t>(slots_.size());
+        slots_.emplace_back();
+        if (chunks_ && local % CHUNK_SIZE == 0) {
+            auto* chunk = new Chunk();
+            for (auto& entry : *chunk)
+                entry.store(nullptr, std::memory_order_relaxed);
+            chunks_[local / CHUNK_SIZE].store(chunk, std::memory_order_release);
+        }
+    } else {
+        return INVALID_HANDLE;
+    }
+
+    auto& target = slots_[local];
+    target.used = true;
+    ++size_;
+    auto index = static_cast<Id>(local * shardCount_ + shard_);
+    return (target.generation << INDEX_BITS) | index;
+}
+
+void GameSlab::set(Id handle, std::shared_ptr<Game> game)
+{
+    auto* target = slot(handle);
+    if (!target)
+        return;
+    if (chunks_)
+        publish(handle, game);
+    target->game = std::move(game);
+}
+
+Game* GameSlab::get(Id handle) const
+{
+    auto* target = slot(handle);
+    return target ? target->game.get() : nullptr;
+}
+
+const std::shared_ptr<Game>* GameSlab::find(Id handle) const
+{
+    auto* target = slot(handle);
+    return target && target->game ? &target->game : nullptr;
+}
+
+std::shared_ptr<Game> GameSlab::release(Id handle)
+{
+    auto* target = slot(handle);
+    if (!target)
+        return nullptr;
+
+    if (chunks_)
+        publish(handle, nullptr);
+    target->used = false;
+    target->generation = (target->generation + 1) & GENERATION_MASK;
+    free_.push_back(static_cast<uint32_t>((handle & INDEX_MASK) / shardCount_));
+    --size_;
+    return std::move(target->game);
+}
+
+size_t GameSlab::size() const
+{
+    return size_;
+}
+
+size_t GameSlab::slotCount() const
+{
+    return slots_.size();
+}
+
+// A slot reused since holds another handle, so comparing the handle also checks the generation
+const std::shared_ptr<Game>* GameSlab::lookup(Id handle) const
+{
+    auto index = handle & INDEX_MASK;
+    if (!chunks_ || index % shardCount_ != shard_)
+        return nullptr;
+    auto local = index / shardCount_;
+    if (local >= capacity_)
+        return nullptr;
+    auto* chunk = chunks_[local / CHUNK_SIZE].load(std::memory_order_acquire);
+    if (!chunk)
+        return nullptr;
+    auto* current = (*chunk)[local % CHUNK_SIZE].load(std::memory_order_acquire);
+    return current && current->handle == handle ? &current->game : nullptr;
+}
+
+void GameSlab::publish(Id handle, std::shared_ptr<Game> game)
+{
+    auto local = (handle & INDEX_MASK) / shardCount_;
+    auto* next = game ? new Published{ handle, std::move(game) } : nullptr;
+    auto& entry = (*chunks_[local / CHUNK_SIZE].load(std::memory_order_relaxed))[local % CHUNK_SIZE];
+    if (auto* previous = entry.exchange(next, std::memory_order_acq_rel))
+        EpochDomain::instance().retire(previous);
+}
+
+// Whoever destroys the slab has made sure nobody reads it any more
+void GameSlab::destroyPublished()
+{
+    if (!chunks_)
+        return;
+    for (size_t i = 0; i * CHUNK_SIZE < slots_.size(); ++i) {
+        auto* chunk = chunks_[i].load(std::memory_order_relaxed);
+        for (auto& entry : *chunk)
+            delete entry.load(std::memory_order_relaxed);
+        delete chunk;
+    }
+    chunks_.reset();
+}
+
+GameSlab::Slot* GameSlab::slot(Id handle)
+{
+    return const_cast<Slot*>(std::as_const(*this).slot(handle));
+}
+
+const GameSlab::Slot* GameSlab::slot(Id handle) const
+{
+    auto index = handle & INDEX_MASK;
+    if (index % shardCount_ != shard_)
+        return nullptr;
+    auto local = index / shardCount_;
+    if (local >= slots_.size())
+        return nullptr;
+    const auto& target = slots_[local];
+    if (!target.used || target.generation != (handle >> INDEX_BITS))
+        return nullptr;
+    return &target;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "game.h"
+#include "common.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// The game slots of one registry shard. A game id is a handle: the slot index in its low bits and
+// the slot's generation in the high ones. Freeing a slot bumps its generation, so the handles of
+// the game that lived there stop matching, and the slot is handed out again. Looking a handle up
+// is an index and a compare, with no hashing and no atomics.
+// Not thread safe, the shard lock guards it. A slab made with published slots can also be read
+// without the lock, see lookup().
+class GameSlab {
+public:
+    static constexpr int INDEX_BITS = 22;
+    static constexpr Id INDEX_MASK = (Id(1) << INDEX_BITS) - 1;
+    static constexpr Id GENERATION_MASK = ~Id(0) >> INDEX_BITS;
+    // Never handed out: its index is beyond every slab
+    static constexpr Id INVALID_HANDLE = ~Id(0);
+
+    // Shard shard of shardCount owns the slot indexes equal to shard modulo shardCount
+    GameSlab(size_t shard = 0, size_t shardCount = 1, bool published = false);
+    ~GameSlab();
+
+    GameSlab(GameSlab&& other) noexcept;
+    GameSlab& operator=(GameSlab&& other) noexcept;
+
+    // A handle to an empty slot, INVALID_HANDLE if the slab is full. The slot holds no game until set().
+    Id reserve();
+    void set(Id handle, std::shared_ptr<Game> game);
+    // The game of a live handle, stale and reserved handles give nullptr
+    Game* get(Id handle) const;
+    const std::shared_ptr<Game>* find(Id handle) const;
+    // Empties the slot and retires its handle, returns the game that was there
+    std::shared_ptr<Game> release(Id handle);
+
+    size_t size() const;
+    // Slots ever used, live or free
+    size_t slotCount() const;
+
+    // Calls visit(handle, game) for the games in up to count slots from the local slot index from
+    // on. Returns the index to go on from, 0 once the last slot was visited.
+    template <typename Visit>
+    size_t visit(size_t from, size_t count, Visit&& visit) const
+    {
+        auto end = std::min(slots_.size(), from + count);
+        for (auto local = from; local < end; ++local) {
+            const auto& target = slots_[local];
+            if (target.used && target.game)
+                visit((target.generation << INDEX_BITS) | static_cast<Id>(local * shardCount_ + shard_), target.game);
+        }
+        return end < slots_.size() ? end : 0;
+    }
+
+    // Like get(), for published slabs without the lock. The caller must stay pinned in the
+    // EpochDomain while it uses the game: a released game is retired, not freed under its readers.
+    const std::shared_ptr<Game>* lookup(Id handle) const;
+
+    static size_t shardOf(Id handle, size_t shardCount)
+    {
+        return (handle & INDEX_MASK) % shardCount;
+    }
+
+private:
+    struct Slot {
+        Id generation = 0;
+        bool used = false;
+        std::shared_ptr<Game> game;
+    };
+
+    // What lock-free readers see of a slot, replaced on every set() and release()
+    struct Published {
+        Id handle;
+        std::shared_ptr<Game> game;
+    };
+    static constexpr size_t CHUNK_SIZE = 1024;
+    using Chunk = std::array<std::atomic<Published*>, CHUNK_SIZE>;
+
+    Slot* slot(Id handle);
+    const Slot* slot(Id handle) const;
+    void publish(Id handle, std::shared_ptr<Game> game);
+    void destroyPublished();
+
+    size_t shard_;
+    size_t shardCount_;
+    size_t capacity_;
+    std::vector<Slot> slots_;
+    // Freed slots are reused oldest first, so generations wrap around as late as possible
+    std::vector<uint32_t> free_;
+    size_t freeHead_;
+    size_t size_;
+    // One chunk per CHUNK_SIZE slots, added with the slots. The directory covers the whole
+    // capacity from the start, so it never moves under a reader.
+    std::unique_ptr<std::atomic<Chunk*>[]> chunks_;
+};
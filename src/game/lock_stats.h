@@ -0,0 +1,30 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+// Time spent waiting for a lock. Only contended acquisitions are counted and timed: an
+// uncontended one takes the try_lock fast path and touches neither the clock nor the counters.
+struct LockStats {
+    std::atomic<uint64_t> contended{0};
+    std::atomic<uint64_t> waitNanos{0};
+};
+
+// Lock is std::unique_lock or std::shared_lock. stats may be null.
+template <typename Lock>
+Lock lockCounted(typename Lock::mutex_type& mutex, LockStats* stats)
+{
+    Lock lock(mutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        auto begin = std::chrono::steady_clock::now();
+        lock.lock();
+        if (stats) {
+            auto waited = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin);
+            stats->contended.fetch_add(1, std::memory_order_relaxed);
+            stats->waitNanos.fetch_add(static_cast<uint64_t>(waited.count()), std::memory_order_relaxed);
+        }
+    }
+    return lock;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "player.h"
+
+#include <atomic>
+#include <memory>
+
+// A player waiting for a quick match, rated or not. The pairing side claims it, the player's side cancels
+// it: only one of them wins, so a player is never paired after giving up or paired twice.
+class MatchTicket {
+public:
+    explicit MatchTicket(std::weak_ptr<Player> player)
+        : player_(std::move(player))
+        , state_(State::Waiting)
+    {}
+
+    std::shared_ptr<Player> player() const
+    {
+        return player_.lock();
+    }
+
+    bool isWaiting() const
+    {
+        return state_.load(std::memory_order_acquire) == State::Waiting;
+    }
+
+    bool claim()
+    {
+        auto expected = State::Waiting;
+        return state_.compare_exchange_strong(expected, State::Pairing, std::memory_order_acq_rel);
+    }
+
+    void finishPairing()
+    {
+        state_.store(State::Paired, std::memory_order_release);
+    }
+
+    // Gives a claimed ticket back when no game came out of it
+    void release()
+    {
+        state_.store(State::Waiting, std::memory_order_release);
+    }
+
+    // Paired, cancelled or left: the ticket will never wait again
+    bool isSettled() const
+    {
+        auto state = state_.load(std::memory_order_acquire);
+        return state == State::Paired || state == State::Cancelled || player_.expired();
+    }
+
+    // False while the player is being put into a game. Once paired, the player is in the game.
+    bool cancel()
+    {
+        auto expected = State::Waiting;
+        return state_.compare_exchange_strong(expected, State::Cancelled, std::memory_order_acq_rel)
+            || expected != State::Pairing;
+    }
+
+private:
+    enum class State { Waiting, Pairing, Paired, Cancelled };
+
+    std::weak_ptr<Player> player_;
+    std::atomic<State> state_;
+};
@@ -0,0 +1,246 @@
+#include "mcts.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int DRAW = 2;
+constexpr float EXPLORATION = 1.41f;
+constexpr int PLAYOUTS_PER_CLOCK_CHECK = 32;
+
+struct Node {
+    uint32_t firstChild = 0;
+    uint16_t childCount = 0;
+    uint16_t cell = 0;
+    uint32_t visits = 0;
+    float wins = 0; // for the side that made the move into this node
+    bool expanded = false;
+};
+
+struct Tree {
+    std::vector<Node> nodes;
+    std::unique_ptr<Board> board;
+    std::vector<uint16_t> free;
+    std::vector<uint32_t> path;
+    uint64_t random = 0;
+    size_t playouts = 0;
+
+    uint32_t nextRandom(uint32_t bound)
+    {
+        // xorshift64
+        random ^= random << 13;
+        random ^= random >> 7;
+        random ^= random << 17;
+        return static_cast<uint32_t>(random % bound);
+    }
+};
+
+} // namespace
+
+class Mcts::Search {
+public:
+    std::vector<Tree> trees;
+    std::unique_ptr<Board> root;
+    std::vector<uint16_t> rootFree;
+    int side = 0;
+    int size = 0;
+    Clock::time_point deadline;
+    std::atomic<size_t> remaining = 0;
+    std::function<void(const MctsResult&)> done;
+
+    void run(Tree& tree, size_t maxNodes);
+    void finish();
+
+private:
+    void playout(Tree& tree, size_t maxNodes);
+    uint32_t selectChild(const Tree& tree, uint32_t parent) const;
+    // Plays tree.free[index]. 0 the game goes on, otherwise the winning side + 1 or DRAW + 1
+    int apply(Tree& tree, size_t index, int side) const;
+};
+
+Mcts::Mcts(size_t threadCount, MctsOptions options)
+    : pool_(threadCount)
+    , options_(options)
+{}
+
+std::shared_ptr<Mcts::Search> Mcts::makeSearch() const
+{
+    auto search = std::make_shared<Search>();
+    search->trees.resize(options_.trees ? options_.trees : pool_.size());
+    for (size_t i = 0; i < search->trees.size(); ++i)
+        search->trees[i].random = 0x9e3779b97f4a7c15ull * (i + 1);
+    return search;
+}
+
+void Mcts::search(const std::shared_ptr<Search>& search, const Board& board, int side,
+                  std::function<void(const MctsResult&)> done)
+{
+    // Boards are only cloned by the first search, later ones copy the cells into them
+    if (!search->root || search->size != board.size()) {
+        search->root = board.clone();
+        for (auto& tree : search->trees)
+            tree.board = board.clone();
+    } else {
+        search->root->restore(board);
+    }
+
+    search->size = board.size();
+    search->side = side;
+    search->rootFree.clear();
+    for (int x = 0; x < search->size; ++x) {
+        for (int y = 0; y < search->size; ++y) {
+            if (board.isFree(x, y))
+                search->rootFree.push_back(static_cast<uint16_t>(x * search->size + y));
+        }
+    }
+
+    search->done = std::move(done);
+    if (search->rootFree.empty()) {
+        search->done(MctsResult{});
+        return;
+    }
+
+    search->deadline = Clock::now() + options_.moveBudget;
+    search->remaining = search->trees.size();
+    for (auto& tree : search->trees) {
+        pool_.submit([search, &tree, maxNodes = options_.maxNodes]()
+            {
+                search->run(tree, maxNodes);
+                if (search->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                    search->finish();
+            });
+    }
+}
+
+size_t Mcts::threadCount() const
+{
+    return pool_.size();
+}
+
+void Mcts::Search::run(Tree& tree, size_t maxNodes)
+{
+    tree.nodes.clear();
+    tree.nodes.emplace_back();
+    tree.playouts = 0;
+    do {
+        for (int i = 0; i < PLAYOUTS_PER_CLOCK_CHECK; ++i)
+            playout(tree, maxNodes);
+    } while (Clock::now() < deadline);
+}
+
+// The move with the most visits over all trees
+void Mcts::Search::finish()
+{
+    std::vector<uint32_t> visits(static_cast<size_t>(size * size));
+    MctsResult result;
+    for (const auto& tree : trees) {
+        const auto& root = tree.nodes.front();
+        for (uint32_t i = 0; i < root.childCount; ++i) {
+            const auto& child = tree.nodes[root.firstChild + i];
+            visits[child.cell] += child.visits;
+        }
+        result.playouts += tree.playouts;
+    }
+
+    auto best = std::max_element(visits.begin(), visits.end()) - visits.begin();
+    result.x = static_cast<int>(best) / size;
+    result.y = static_cast<int>(best) % size;
+    auto callback = std::move(done);
+    callback(result);
+}
+
+void Mcts::Search::playout(Tree& tree, size_t maxNodes)
+{
+    tree.board->restore(*root);
+    tree.free = rootFree;
+    tree.path.clear();
+    tree.path.push_back(0);
+
+    int turn = side;
+    int outcome = 0;
+    uint32_t node = 0;
+
+    // Selection
+    while (!outcome && tree.nodes[node].expanded) {
+        node = selectChild(tree, node);
+        tree.path.push_back(node);
+        auto cell = std::find(tree.free.begin(), tree.free.end(), tree.nodes[node].cell);
+        outcome = apply(tree, static_cast<size_t>(cell - tree.free.begin()), turn);
+        turn ^= 1;
+    }
+
+    // Expansion: every free cell becomes a child, one of them is played
+    if (!outcome && tree.nodes.size() + tree.free.size() <= maxNodes) {
+        auto firstChild = static_cast<uint32_t>(tree.nodes.size());
+        for (auto cell : tree.free) {
+            tree.nodes.emplace_back();
+            tree.nodes.back().cell = cell;
+        }
+        auto& parent = tree.nodes[node];
+        parent.firstChild = firstChild;
+        parent.childCount = static_cast<uint16_t>(tree.free.size());
+        parent.expanded = true;
+
+        auto index = tree.nextRandom(parent.childCount);
+        node = firstChild + index;
+        tree.path.push_back(node);
+        outcome = apply(tree, index, turn);
+        turn ^= 1;
+    }
+
+    // Random rollout
+    while (!outcome) {
+        outcome = apply(tree, tree.nextRandom(static_cast<uint32_t>(tree.free.size())), turn);
+        turn ^= 1;
+    }
+
+    // The node at depth d was entered by a move of side ^ ((d - 1) & 1)
+    int winner = outcome - 1;
+    for (size_t depth = 0; depth < tree.path.size(); ++depth) {
+        auto& current = tree.nodes[tree.path[depth]];
+        ++current.visits;
+        if (depth == 0)
+            continue;
+        int mover = side ^ static_cast<int>((depth - 1) & 1);
+        current.wins += winner == DRAW ? 0.5f : (winner == mover ? 1.0f : 0.0f);
+    }
+    ++tree.playouts;
+}
+
+uint32_t Mcts::Search::selectChild(const Tree& tree, uint32_t parent) const
+{
+    const auto& node = tree.nodes[parent];
+    float logVisits = std::log(static_cast<float>(std::max<uint32_t>(node.visits, 1)));
+    uint32_t best = node.firstChild;
+    float bestScore = -std::numeric_limits<float>::infinity();
+    for (uint32_t i = node.firstChild; i < node.firstChild + node.childCount; ++i) {
+        const auto& child = tree.nodes[i];
+        if (child.visits == 0)
+            return i;
+        float score = child.wins / static_cast<float>(child.visits)
+                + EXPLORATION * std::sqrt(logVisits / static_cast<float>(child.visits));
+        if (score > bestScore) {
+            bestScore = score;
+            best = i;
+        }
+    }
+    return best;
+}
+
+int Mcts::Search::apply(Tree& tree, size_t index, int side) const
+{
+    auto cell = tree.free[index];
+    tree.free[index] = tree.free.back();
+    tree.free.pop_back();
+
+    if (tree.board->place(side, cell / size, cell % size))
+        return side + 1;
+    return tree.free.empty() ? DRAW + 1 : 0;
+}
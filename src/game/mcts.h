@@ -0,0 +1,46 @@
+#pragma once
+
+#include "board.h"
+#include "work_stealing_pool.h"
+
+#include <chrono>
+#include <functional>
+#include <memory>
+
+struct MctsOptions {
+    std::chrono::milliseconds moveBudget{200};
+    // Independent trees searched in parallel for one move, their root statistics are merged.
+    // 0: one tree per pool thread.
+    size_t trees = 0;
+    // Per tree, the tree stops growing once it is reached and only keeps doing playouts
+    size_t maxNodes = 1 << 18;
+};
+
+struct MctsResult {
+    int x = -1;
+    int y = -1;
+    size_t playouts = 0;
+};
+
+// Monte Carlo tree search on the Board used by Game, with root parallelization over its own pool
+class Mcts {
+public:
+    // Search state of one bot: trees, scratch boards and the root. It keeps its memory between
+    // moves, so after the first move a search allocates nothing. One search at a time.
+    class Search;
+
+    Mcts(size_t threadCount, MctsOptions options);
+
+    std::shared_ptr<Search> makeSearch() const;
+
+    // Looks for the best move of side on board within the move budget. done is called once on a
+    // pool thread, or right away with x == -1 if the board has no free cell.
+    void search(const std::shared_ptr<Search>& search, const Board& board, int side,
+                std::function<void(const MctsResult&)> done);
+
+    size_t threadCount() const;
+
+private:
+    WorkStealingPool pool_;
+    MctsOptions options_;
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <memory>
+#include <optional>
+
+// Bounded multi-producer multi-consumer queue without locks. Every cell carries a sequence number
+// that tells whether it is free for the producer or ready for the consumer of a given position,
+// so producers and consumers only contend on their own position counter with a CAS.
+template <typename T>
+class MpmcQueue {
+public:
+    // capacity is rounded up to a power of two
+    explicit MpmcQueue(size_t capacity)
+        : mask_(std::bit_ceil(std::max<size_t>(capacity, 2)) - 1)
+        , cells_(std::make_unique<Cell[]>(mask_ + 1))
+        , enqueuePos_(0)
+        , dequeuePos_(0)
+    {
+        for (size_t i = 0; i <= mask_; ++i)
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    MpmcQueue(const MpmcQueue&) = delete;
+    MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+    // Returns false if the queue is full
+    bool push(T value)
+    {
+        auto pos = enqueuePos_.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells_[pos & mask_];
+            auto sequence = cell->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueuePos_.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    std::optional<T> pop()
+    {
+        auto pos = dequeuePos_.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells_[pos & mask_];
+            auto sequence = cell->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            } else if (diff < 0) {
+                return std::nullopt;
+            } else {
+                pos = dequeuePos_.load(std::memory_order_relaxed);
+            }
+        }
+        std::optional<T> value(std::move(cell->value));
+        cell->value = T();
+        cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+        return value;
+    }
+
+    size_t capacity() const
+    {
+        return mask_ + 1;
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    const size_t mask_;
+    std::unique_ptr<Cell[]> cells_;
+    // Apart, so that producers and consumers don't share a cache line
+    alignas(64) std::atomic<size_t> enqueuePos_;
+    alignas(64) std::atomic<size_t> dequeuePos_;
+};
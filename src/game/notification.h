@@ -11,11 +11,22 @@ struct Notification {
         PlayerLeft,
         PlayerMoved,
         GameEnded,
+        // Paired by the rated matcher into the second seat of a game, the player moves second
+        MatchFound,
     };
 
     Type type;
     std::string playerNickname;
-    std::string extraInfo;
+
+    // PlayerMoved: the cell and the mark put into it
+    int x = 0;
+    int y = 0;
+    char mark = 0;
+
+    // MatchFound: the game the player was paired into
+    Id gameId = 0;
+
+    bool operator==(const Notification&) const = default;
 };
 
 using NotificationHandler = std::function<void(const Notification&)>;
@@ -1,9 +1,11 @@
 #include "player.h"
 
-Player::Player(Id id, const std::string& nickname)
+Player::Player(Id id, const std::string& nickname, bool bot)
     : id_(std::move(id))
     , nickname_(nickname)
+    , bot_(bot)
     , curGameId_(std::nullopt)
+    , rating_(INITIAL_RATING)
 {}
 
 const Id& Player::id() const
@@ -15,6 +17,11 @@ const std::string& Player::nickname() const {
     return nickname_;
 }
 
+bool Player::isBot() const
+{
+    return bot_;
+}
+
 bool Player::isInGame() const
 {
     return curGameId_.has_value();
@@ -25,6 +32,16 @@ std::optional<Id> Player::curGameId() const
     return curGameId_;
 }
 
+double Player::rating() const
+{
+    return rating_.load(std::memory_order_relaxed);
+}
+
+void Player::setRating(double rating)
+{
+    rating_.store(rating, std::memory_order_relaxed);
+}
+
 bool Player::joinGame(const Id& gameId)
 {
     if (isInGame())
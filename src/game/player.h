@@ -2,21 +2,29 @@
 
 #include "notification.h"
 #include "common.h"
+#include "rating.h"
 
 #include <boost/uuid/uuid.hpp>
 
+#include <atomic>
 #include <optional>
 #include <memory>
 
 class Player {
 public:
-    explicit Player(Id id, const std::string& nickname);
+    explicit Player(Id id, const std::string& nickname, bool bot = false);
 
     const Id& id() const;
     const std::string& nickname() const;
+    // Played by the server, see Bot. Games against bots are never rated.
+    bool isBot() const;
     bool isInGame() const;
     std::optional<Id> curGameId() const;
 
+    // Elo rating, changed by the game that ends. Matchmaking reads it from other threads.
+    double rating() const;
+    void setRating(double rating);
+
     bool joinGame(const Id& gameId);
     bool leaveGame();
 
@@ -26,7 +34,9 @@ public:
 private:
     Id id_;
     std::string nickname_;
+    bool bot_;
     std::optional<Id> curGameId_;
+    std::atomic<double> rating_;
 
     NotificationHandler notificationHandler_;
 };
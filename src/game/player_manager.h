@@ -8,9 +8,9 @@
 
 class PlayerManager {
 public:
-    std::shared_ptr<Player> createPlayer(const std::string& nickname)
+    std::shared_ptr<Player> createPlayer(const std::string& nickname, bool bot = false)
     {
-        return std::make_shared<Player>(getNewId(), nickname);
+        return std::make_shared<Player>(getNewId(), nickname, bot);
     }
 
 private:
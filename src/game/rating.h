@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cmath>
+
+// Elo ratings, updated after every decided game between two players
+constexpr double INITIAL_RATING = 1500.0;
+constexpr double RATING_K_FACTOR = 32.0;
+
+// Chance of a player rated rating to beat one rated opponentRating
+inline double expectedScore(double rating, double opponentRating)
+{
+    return 1.0 / (1.0 + std::pow(10.0, (opponentRating - rating) / 400.0));
+}
+
+// score: 1 for a win, 0.5 for a draw, 0 for a loss
+inline double updatedRating(double rating, double opponentRating, double score)
+{
+    return rating + RATING_K_FACTOR * (score - expectedScore(rating, opponentRating));
+}
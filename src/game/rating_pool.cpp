@@ -0,0 +1,100 @@
+#include "rating_pool.h"
+
+#include <algorithm>
+#include <cmath>
+
+RatingPool::RatingPool(RatingWindow window)
+    : window_(window)
+    , buckets_(static_cast<size_t>(std::ceil(window.maxRating / window.bandWidth)) + 1)
+    , size_(0)
+{}
+
+void RatingPool::add(std::shared_ptr<MatchTicket> ticket, double rating, Clock::time_point now)
+{
+    auto lock = lockCounted<std::unique_lock<std::mutex>>(mutex_, &lockStats_);
+    buckets_[bucket(rating)].push_back(Entry{ std::move(ticket), rating, now });
+    ++size_;
+}
+
+std::optional<RatingPool::Match> RatingPool::take(const std::shared_ptr<Player>& player, Clock::time_point now)
+{
+    auto lock = lockCounted<std::unique_lock<std::mutex>>(mutex_, &lockStats_);
+    return takeLocked(player, player->rating(), window_.initial, now);
+}
+
+size_t RatingPool::size() const
+{
+    auto lock = lockCounted<std::unique_lock<std::mutex>>(mutex_, &lockStats_);
+    return size_;
+}
+
+const LockStats& RatingPool::lockStats() const
+{
+    return lockStats_;
+}
+
+double RatingPool::window(Clock::time_point queuedAt, Clock::time_point now) const
+{
+    auto waited = std::chrono::duration<double>(now - queuedAt).count();
+    return std::min(window_.initial + window_.widenPerSecond * std::max(waited, 0.0), window_.max);
+}
+
+size_t RatingPool::bucket(double rating) const
+{
+    auto band = static_cast<long>(std::floor(rating / window_.bandWidth));
+    return static_cast<size_t>(std::clamp<long>(band, 0, static_cast<long>(buckets_.size()) - 1));
+}
+
+// Settled tickets are dropped once they reach the front, claimed ones are skipped: they go back
+// to waiting or get settled soon
+RatingPool::Entry* RatingPool::firstWaiting(size_t bucket, const std::shared_ptr<Player>& self, std::shared_ptr<Player>& player)
+{
+    auto& entries = buckets_[bucket];
+    while (!entries.empty() && entries.front().ticket->isSettled()) {
+        entries.pop_front();
+        --size_;
+    }
+    for (auto& entry : entries) {
+        if (!entry.ticket->isWaiting())
+            continue;
+        player = entry.ticket->player();
+        if (player && player != self)
+            return &entry;
+    }
+    return nullptr;
+}
+
+std::optional<RatingPool::Match> RatingPool::takeLocked(const std::shared_ptr<Player>& self, double rating, double reach,
+                                                        Clock::time_point now)
+{
+    auto center = static_cast<long>(bucket(rating));
+    auto bands = static_cast<long>(std::ceil(window_.max / window_.bandWidth));
+    auto first = static_cast<size_t>(std::max(center - bands, 0L));
+    auto last = static_cast<size_t>(std::min(center + bands, static_cast<long>(buckets_.size()) - 1));
+
+    // A candidate whose ticket is cancelled while being claimed is settled, the search is repeated without it
+    while (true) {
+        Entry* best = nullptr;
+        std::shared_ptr<Player> bestPlayer;
+        double bestDistance = 0.0;
+        for (auto i = first; i <= last; ++i) {
+            std::shared_ptr<Player> player;
+            auto* entry = firstWaiting(i, self, player);
+            if (!entry)
+                continue;
+            auto distance = std::abs(entry->rating - rating);
+            if (distance > std::max(reach, window(entry->queuedAt, now)))
+                continue;
+            if (!best || distance < bestDistance) {
+                best = entry;
+                bestPlayer = std::move(player);
+                bestDistance = distance;
+            }
+        }
+
+        if (!best)
+            return std::nullopt;
+        if (best->ticket->claim())
+            return Match{ best->ticket, std::move(bestPlayer), best->queuedAt };
+    }
+}
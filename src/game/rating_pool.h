@@ -0,0 +1,110 @@
+#pragma once
+
+#include "lock_stats.h"
+#include "match_ticket.h"
+
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+struct RatingWindow {
+    // Rating difference accepted right away, and how it grows while a player waits
+    double initial = 100.0;
+    double widenPerSecond = 25.0;
+    double max = 400.0;
+    // Ratings in one band share a bucket, a search looks at the bands within max on each side
+    double bandWidth = 50.0;
+    double maxRating = 4000.0;
+};
+
+// Players waiting for a rated match, bucketed by rating band. Every bucket keeps its players in
+// arrival order, so its first waiting player is the one of the band with the widest window.
+// A search only looks at that player in each band within reach: its cost depends on the window
+// and not on how many players wait.
+class RatingPool {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // A claimed waiting player, its ticket is finished or released by the caller
+    struct Match {
+        std::shared_ptr<MatchTicket> ticket;
+        std::shared_ptr<Player> player;
+        Clock::time_point queuedAt;
+    };
+
+    explicit RatingPool(RatingWindow window = {});
+
+    void add(std::shared_ptr<MatchTicket> ticket, double rating, Clock::time_point now);
+
+    // Of the first waiting player of each band, the closest one within the window of either side.
+    // A closer player further back in a band is not looked at. A player that has just come has the
+    // initial window.
+    std::optional<Match> take(const std::shared_ptr<Player>& player, Clock::time_point now);
+
+    // Pairs the players whose windows have grown to reach each other, the one of each pair that
+    // waited longer comes first. The pairs are made outside the pool lock.
+    template <typename OnPair>
+    size_t matchWaiting(Clock::time_point now, OnPair&& onPair);
+
+    // Waiting players, and tickets not dropped yet
+    size_t size() const;
+    const LockStats& lockStats() const;
+
+private:
+    struct Entry {
+        std::shared_ptr<MatchTicket> ticket;
+        double rating;
+        Clock::time_point queuedAt;
+    };
+
+    double window(Clock::time_point queuedAt, Clock::time_point now) const;
+    size_t bucket(double rating) const;
+
+    // Must be called with the mutex held
+    Entry* firstWaiting(size_t bucket, const std::shared_ptr<Player>& self, std::shared_ptr<Player>& player);
+    std::optional<Match> takeLocked(const std::shared_ptr<Player>& self, double rating, double reach, Clock::time_point now);
+
+    RatingWindow window_;
+    std::vector<std::deque<Entry>> buckets_;
+    size_t size_;
+
+    mutable std::mutex mutex_;
+    mutable LockStats lockStats_;
+};
+
+template <typename OnPair>
+size_t RatingPool::matchWaiting(Clock::time_point now, OnPair&& onPair)
+{
+    std::vector<std::pair<Match, Match>> pairs;
+    {
+        auto lock = lockCounted<std::unique_lock<std::mutex>>(mutex_, &lockStats_);
+        for (size_t i = 0; i < buckets_.size(); ++i) {
+            // After a pair the band's next player may find someone too
+            while (true) {
+                std::shared_ptr<Player> player;
+                auto* entry = firstWaiting(i, nullptr, player);
+                if (!entry)
+                    break;
+                if (!entry->ticket->claim())
+                    continue;
+                Match first{ entry->ticket, std::move(player), entry->queuedAt };
+                auto second = takeLocked(first.player, entry->rating, window(entry->queuedAt, now), now);
+                if (!second) {
+                    first.ticket->release();
+                    break;
+                }
+                if (second->queuedAt < first.queuedAt)
+                    pairs.emplace_back(std::move(*second), std::move(first));
+                else
+                    pairs.emplace_back(std::move(first), std::move(*second));
+            }
+        }
+    }
+
+    for (auto& [first, second] : pairs)
+        onPair(std::move(first), std::move(second));
+    return pairs.size();
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+// Every reachable 3x3 position solved at compile time. A position is indexed in base 3, cell
+// x * 3 + y contributes 0 (empty), 1 (X) or 2 (O) times 3^cell.
+class SolvedTable {
+public:
+    static constexpr int POSITIONS = 19683;
+    static constexpr uint8_t NO_MOVE = 0xff;
+
+    static constexpr std::array<int, 9> POW3 = {1, 3, 9, 27, 81, 243, 729, 2187, 6561};
+
+    // side 0 is X
+    static constexpr int withMove(int index, int side, int cell)
+    {
+        return index + (side + 1) * POW3[cell];
+    }
+
+    // Best cell for the side to move, NO_MOVE for finished and unreachable positions
+    static constexpr uint8_t bestMove(int index)
+    {
+        return TABLE.bestMove[index];
+    }
+
+    // Outcome for the side to move under perfect play: 1 win, 0 draw, -1 loss
+    static constexpr int value(int index)
+    {
+        return TABLE.value[index] - 2;
+    }
+
+private:
+    struct Table {
+        std::array<uint8_t, POSITIONS> bestMove{};
+        std::array<uint8_t, POSITIONS> value{}; // outcome + 2, 0 while unsolved
+    };
+
+    static constexpr std::array<std::array<int, 3>, 8> LINES = {{
+        {0, 1, 2}, {3, 4, 5}, {6, 7, 8},
+        {0, 3, 6}, {1, 4, 7}, {2, 5, 8},
+        {0, 4, 8}, {2, 4, 6},
+    }};
+
+    static constexpr bool hasLine(const std::array<int, 9>& cells, int mark)
+    {
+        for (const auto& line : LINES) {
+            if (cells[line[0]] == mark && cells[line[1]] == mark && cells[line[2]] == mark)
+                return true;
+        }
+        return false;
+    }
+
+    // Negamax over the positions reachable from this one, each is solved once
+    static constexpr int solve(Table& table, std::array<int, 9>& cells, int index, int side)
+    {
+        if (table.value[index])
+            return table.value[index] - 2;
+
+        int best = -2;
+        uint8_t bestMove = NO_MOVE;
+        if (hasLine(cells, 2 - side)) {
+            best = -1; // the previous move won
+        } else {
+            for (int cell = 0; cell < 9; ++cell) {
+                if (cells[cell])
+                    continue;
+                cells[cell] = side + 1;
+                int value = -solve(table, cells, withMove(index, side, cell), 1 - side);
+                cells[cell] = 0;
+                if (value > best) {
+                    best = value;
+                    bestMove = static_cast<uint8_t>(cell);
+                }
+            }
+            if (bestMove == NO_MOVE)
+                best = 0; // full board
+        }
+
+        table.value[index] = static_cast<uint8_t>(best + 2);
+        table.bestMove[index] = bestMove;
+        return best;
+    }
+
+    static constexpr Table makeTable()
+    {
+        Table table{};
+        table.bestMove.fill(NO_MOVE);
+        std::array<int, 9> cells{};
+        solve(table, cells, 0, 0);
+        return table;
+    }
+
+    static const Table TABLE;
+};
+
+// Defined out of the class, makeTable is only usable once SolvedTable is complete
+inline constexpr SolvedTable::Table SolvedTable::TABLE = SolvedTable::makeTable();
@@ -0,0 +1,100 @@
+#include "work_stealing_pool.h"
+
+#include <algorithm>
+
+namespace {
+
+// Index of the worker running on this thread, if any
+thread_local const WorkStealingPool* currentPool = nullptr;
+thread_local size_t currentWorker = 0;
+
+} // namespace
+
+WorkStealingPool::WorkStealingPool(size_t threadCount)
+    : nextWorker_(0)
+    , pending_(0)
+    , stop_(false)
+{
+    threadCount = std::max<size_t>(threadCount, 1);
+    for (size_t i = 0; i < threadCount; ++i)
+        workers_.push_back(std::make_unique<Worker>());
+    for (size_t i = 0; i < threadCount; ++i)
+        threads_.emplace_back([this, i]() { run(i); });
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::lock_guard lock(sleepMutex_);
+        stop_ = true;
+    }
+    wakeUp_.notify_all();
+    for (auto& thread : threads_)
+        thread.join();
+}
+
+void WorkStealingPool::submit(std::function<void()> task)
+{
+    size_t index = currentPool == this ? currentWorker : nextWorker_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
+    {
+        std::lock_guard lock(workers_[index]->mutex);
+        workers_[index]->tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard lock(sleepMutex_);
+        ++pending_;
+    }
+    wakeUp_.notify_one();
+}
+
+size_t WorkStealingPool::size() const
+{
+    return workers_.size();
+}
+
+void WorkStealingPool::run(size_t index)
+{
+    currentPool = this;
+    currentWorker = index;
+
+    while (true) {
+        {
+            std::unique_lock lock(sleepMutex_);
+            wakeUp_.wait(lock, [this]() { return stop_ || pending_ > 0; });
+            if (stop_)
+                return;
+            --pending_;
+        }
+
+        // A pending task is reserved above, so one of the deques holds it
+        std::function<void()> task;
+        while (!(task = take(index)))
+            std::this_thread::yield();
+        task();
+    }
+}
+
+std::function<void()> WorkStealingPool::take(size_t index)
+{
+    std::function<void()> task;
+    {
+        auto& own = *workers_[index];
+        std::lock_guard lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return task;
+        }
+    }
+
+    for (size_t i = 1; i < workers_.size(); ++i) {
+        auto& victim = *workers_[(index + i) % workers_.size()];
+        std::lock_guard lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return task;
+        }
+    }
+    return task;
+}
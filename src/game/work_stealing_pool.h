@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Threads for CPU-bound jobs such as bot searches, kept apart from the io_context threads.
+// Every worker has its own deque: it takes its newest task first and, once out of work, steals
+// the oldest task of another worker.
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(size_t threadCount);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    // From a worker the task goes to the worker's own deque, otherwise the deques take turns
+    void submit(std::function<void()> task);
+
+    size_t size() const;
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void run(size_t index);
+    std::function<void()> take(size_t index);
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::thread> threads_;
+    std::atomic<size_t> nextWorker_;
+
+    std::mutex sleepMutex_;
+    std::condition_variable wakeUp_;
+    size_t pending_;
+    bool stop_;
+};
@@ -2,8 +2,8 @@
 
 int main()
 {
-    Server server(std::thread::hardware_concurrency(), 8080);
+    Server server(std::thread::hardware_concurrency(), 8080, ServerOptions{ .sharded = true, .reusePort = true });
     server.start();
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// Building blocks of the binary protocol: a one byte opcode followed by LEB128 varints,
+// varint length-prefixed strings and moves packed into a single byte.
+
+inline void writeVarint(std::string& out, uint64_t value)
+{
+    while (value >= 0x80) {
+        out += static_cast<char>((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+inline void writeString(std::string& out, std::string_view value)
+{
+    writeVarint(out, value.size());
+    out += value;
+}
+
+// Boards are at most 16x16, so a move is a nibble per coordinate
+inline char packMove(int x, int y)
+{
+    return static_cast<char>(((x & 0x0f) << 4) | (y & 0x0f));
+}
+
+inline std::pair<int, int> unpackMove(uint8_t packed)
+{
+    return { packed >> 4, packed & 0x0f };
+}
+
+class BinaryReader {
+public:
+    explicit BinaryReader(std::string_view data)
+        : data_(data)
+    {}
+
+    bool empty() const
+    {
+        return data_.empty();
+    }
+
+    std::optional<uint8_t> byte()
+    {
+        if (data_.empty())
+            return std::nullopt;
+        auto value = static_cast<uint8_t>(data_.front());
+        data_.remove_prefix(1);
+        return value;
+    }
+
+    std::optional<uint64_t> varint()
+    {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            auto next = byte();
+            if (!next)
+                return std::nullopt;
+            value |= static_cast<uint64_t>(*next & 0x7f) << shift;
+            if (!(*next & 0x80))
+                return value;
+        }
+        return std::nullopt;
+    }
+
+    template <typename T>
+    std::optional<T> number()
+    {
+        auto value = varint();
+        if (!value || *value > static_cast<uint64_t>(std::numeric_limits<T>::max()))
+            return std::nullopt;
+        return static_cast<T>(*value);
+    }
+
+    std::optional<std::string_view> string()
+    {
+        auto size = varint();
+        if (!size || *size > data_.size())
+            return std::nullopt;
+        auto value = data_.substr(0, *size);
+        data_.remove_prefix(*size);
+        return value;
+    }
+
+    std::string_view rest() const
+    {
+        return data_;
+    }
+
+private:
+    std::string_view data_;
+};
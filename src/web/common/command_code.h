@@ -1,5 +1,11 @@
 #pragma once
 
+// Wire encoding of a connection, chosen by the client at handshake
+enum class Encoding {
+    Text,   // space separated decimal fields
+    Binary, // see binary_codec.h
+};
+
 enum InCommandCode {
     AUTH        = 0,
     CREATE_GAME = 1,
@@ -7,8 +13,11 @@ enum InCommandCode {
     JOIN_GAME   = 3,
     LEAVE_GAME  = 4,
     MOVE        = 5,
+    QUICK_MATCH = 6,
 };
 
+constexpr int IN_COMMAND_COUNT = QUICK_MATCH + 1;
+
 enum OutCommandCode {
     ERROR           = -1,
     PLAYER_AUTHED   = 0,
@@ -19,6 +28,7 @@ enum OutCommandCode {
     MOVED           = 5,
     OPPONENT_JOINED = 6,
     GAME_ENDED      = 7,
+    MATCH_QUEUED    = 8,
 };
 
 enum ErrorCode {
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "binary_codec.h"
+#include "command_code.h"
+
+#include <array>
+#include <charconv>
+#include <optional>
+#include <string_view>
+
+// Space separated tokens of a text command. Tokens are views into the command, so it has to
+// outlive them.
+class CommandTokens {
+public:
+    static constexpr size_t MaxTokens = 8;
+
+    explicit CommandTokens(std::string_view command)
+        : size_(0)
+    {
+        while (size_ < MaxTokens) {
+            auto pos = command.find(' ');
+            tokens_[size_++] = command.substr(0, pos);
+            if (pos == std::string_view::npos)
+                break;
+            command.remove_prefix(pos + 1);
+        }
+    }
+
+    size_t size() const
+    {
+        return size_;
+    }
+
+    // Missing tokens are empty, so they fail to parse like malformed ones
+    std::string_view operator[](size_t index) const
+    {
+        return index < size_ ? tokens_[index] : std::string_view{};
+    }
+
+private:
+    std::array<std::string_view, MaxTokens> tokens_;
+    size_t size_;
+};
+
+// The whole token has to be a number
+template <typename T>
+std::optional<T> parseNumber(std::string_view token)
+{
+    T value{};
+    auto [end, ec] = std::from_chars(token.data(), token.data() + token.size(), value);
+    if (ec != std::errc() || end != token.data() + token.size() || token.empty())
+        return std::nullopt;
+    return value;
+}
+
+// Reads the arguments of one command in order, whichever encoding it came in
+class CommandReader {
+public:
+    CommandReader(std::string_view command, Encoding encoding)
+        : encoding_(encoding)
+        , tokens_(encoding == Encoding::Text ? command : std::string_view{})
+        , index_(0)
+        , binary_(encoding == Encoding::Binary ? command : std::string_view{})
+    {}
+
+    std::optional<int> code()
+    {
+        if (encoding_ == Encoding::Binary) {
+            auto code = binary_.byte();
+            return code ? std::make_optional<int>(*code) : std::nullopt;
+        }
+        return number<int>();
+    }
+
+    bool hasMore() const
+    {
+        return encoding_ == Encoding::Binary ? !binary_.empty() : index_ < tokens_.size();
+    }
+
+    template <typename T>
+    std::optional<T> number()
+    {
+        if (encoding_ == Encoding::Binary)
+            return binary_.number<T>();
+        return parseNumber<T>(tokens_[index_++]);
+    }
+
+    std::optional<std::string_view> string()
+    {
+        if (encoding_ == Encoding::Binary)
+            return binary_.string();
+        if (index_ >= tokens_.size())
+            return std::nullopt;
+        return tokens_[index_++];
+    }
+
+    std::optional<std::pair<int, int>> move()
+    {
+        if (encoding_ == Encoding::Binary) {
+            auto packed = binary_.byte();
+            return packed ? std::make_optional(unpackMove(*packed)) : std::nullopt;
+        }
+        auto x = number<int>();
+        auto y = number<int>();
+        if (!x || !y)
+            return std::nullopt;
+        return std::make_pair(*x, *y);
+    }
+
+private:
+    Encoding encoding_;
+    CommandTokens tokens_;
+    size_t index_;
+    BinaryReader binary_;
+};
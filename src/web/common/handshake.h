@@ -0,0 +1,40 @@
+#pragma once
+
+#include "command_code.h"
+
+#include <string_view>
+
+// Per-connection protocol options requested by the client in the upgrade request target,
+// e.g. "/?batch=1&encoding=binary"
+struct HandshakeOptions {
+    // Queued messages are flushed together as one frame, separated by '\n' in text and
+    // prefixed with their varint length in binary
+    bool batch = false;
+    Encoding encoding = Encoding::Text;
+};
+
+inline std::string_view getQueryParam(std::string_view target, std::string_view name)
+{
+    auto pos = target.find('?');
+    if (pos == std::string_view::npos)
+        return {};
+
+    auto query = target.substr(pos + 1);
+    while (!query.empty()) {
+        auto end = query.find('&');
+        auto param = query.substr(0, end);
+        auto eq = param.find('=');
+        if (param.substr(0, eq) == name)
+            return eq == std::string_view::npos ? std::string_view{} : param.substr(eq + 1);
+        query = end == std::string_view::npos ? std::string_view{} : query.substr(end + 1);
+    }
+    return {};
+}
+
+inline HandshakeOptions parseHandshakeOptions(std::string_view target)
+{
+    return {
+        .batch = getQueryParam(target, "batch") == "1",
+        .encoding = getQueryParam(target, "encoding") == "binary" ? Encoding::Binary : Encoding::Text,
+    };
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "binary_codec.h"
+#include "command_code.h"
+
+#include <charconv>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// Immutable serialized message. Several write queues may point at the same one.
+using SharedBuffer = std::shared_ptr<const std::string>;
+
+// Builds one outgoing message in the connection's encoding. Text fields are separated by spaces,
+// binary fields follow the one byte opcode back to back.
+class OutMessage {
+public:
+    OutMessage(Encoding encoding, OutCommandCode code)
+        : encoding_(encoding)
+    {
+        if (encoding_ == Encoding::Binary)
+            data_ += static_cast<char>(static_cast<int8_t>(code));
+        else
+            appendDecimal(static_cast<int64_t>(code));
+    }
+
+    OutMessage& number(uint64_t value)
+    {
+        if (encoding_ == Encoding::Binary) {
+            writeVarint(data_, value);
+        } else {
+            data_ += ' ';
+            appendDecimal(value);
+        }
+        return *this;
+    }
+
+    OutMessage& string(std::string_view value)
+    {
+        if (encoding_ == Encoding::Binary) {
+            writeString(data_, value);
+        } else {
+            data_ += ' ';
+            data_ += value;
+        }
+        return *this;
+    }
+
+    // "x y mark" in text, packed coordinates and the mark byte in binary
+    OutMessage& move(int x, int y, char mark)
+    {
+        if (encoding_ == Encoding::Binary) {
+            data_ += packMove(x, y);
+            data_ += mark;
+        } else {
+            number(x).number(y);
+            data_ += ' ';
+            data_ += mark;
+        }
+        return *this;
+    }
+
+    // A game of the lobby, size 0 for the classic board. "id|name" in text, other boards append
+    // "|size|winLength". Binary always carries both, 0 0 for the classic board.
+    OutMessage& entry(uint64_t id, std::string_view name, uint64_t size = 0, uint64_t winLength = 0)
+    {
+        if (encoding_ == Encoding::Binary)
+            return number(id).string(name).number(size).number(winLength);
+
+        number(id);
+        data_ += '|';
+        data_ += name;
+        if (size != 0) {
+            data_ += '|';
+            appendDecimal(size);
+            data_ += '|';
+            appendDecimal(winLength);
+        }
+        return *this;
+    }
+
+    // Moves the built message out, the builder is empty afterwards
+    std::string str()
+    {
+        return std::move(data_);
+    }
+
+private:
+    template <typename T>
+    void appendDecimal(T value)
+    {
+        char buf[24];
+        auto [end, _] = std::to_chars(buf, buf + sizeof(buf), value);
+        data_.append(buf, end);
+    }
+
+    Encoding encoding_;
+    std::string data_;
+};
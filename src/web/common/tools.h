@@ -1,8 +1,10 @@
 #pragma once
 
+#include "binary_codec.h"
 #include "command_code.h"
 #include <optional>
 #include <string>
+#include <vector>
 
 struct Message
 {
@@ -27,3 +29,82 @@ Message getInMessage(const std::string& data)
         .errorCode = static_cast<ErrorCode>(std::stoi(message.substr(0, pos))),
         .message = pos == std::string::npos ? "" : message.substr(pos + 1)};
 }
+
+// Decodes a binary protocol message into the same Message the text protocol produces
+inline Message getInBinaryMessage(std::string_view data)
+{
+    BinaryReader reader(data);
+    auto code = static_cast<OutCommandCode>(static_cast<int8_t>(reader.byte().value_or(0)));
+    auto number = [&reader]() { return std::to_string(reader.varint().value_or(0)); };
+    auto string = [&reader]() { return std::string(reader.string().value_or("")); };
+
+    Message result{ .code = code };
+    switch (code) {
+        case OutCommandCode::ERROR:
+            result.errorCode = static_cast<ErrorCode>(reader.varint().value_or(0));
+            break;
+        case OutCommandCode::PLAYER_AUTHED:
+        case OutCommandCode::GAME_CREATED:
+            result.message = number();
+            break;
+        case OutCommandCode::GAME_LIST:
+            while (!reader.empty()) {
+                if (!result.message.empty())
+                    result.message += ' ';
+                result.message += number();
+                result.message += '|' + string();
+                auto size = number();
+                auto winLength = number();
+                if (size != "0")
+                    result.message += '|' + size + '|' + winLength;
+            }
+            break;
+        case OutCommandCode::JOINED_GAME:
+            result.message = number();
+            result.message += ' ' + string();
+            // Boards other than the classic one
+            if (!reader.empty()) {
+                result.message += ' ' + number();
+                result.message += ' ' + number();
+            }
+            break;
+        case OutCommandCode::LEFT_GAME:
+        case OutCommandCode::MATCH_QUEUED:
+            break;
+        case OutCommandCode::MOVED: {
+            auto [x, y] = unpackMove(reader.byte().value_or(0));
+            char mark = static_cast<char>(reader.byte().value_or(0));
+            result.message = std::to_string(x) + ' ' + std::to_string(y) + ' ' + mark + ' ' + string();
+            break;
+        }
+        case OutCommandCode::OPPONENT_JOINED:
+            result.message = string();
+            break;
+        case OutCommandCode::GAME_ENDED:
+            result.message = number();
+            if (!reader.empty())
+                result.message += ' ' + string();
+            break;
+    }
+    return result;
+}
+
+// Messages of a frame received with batching enabled
+inline std::vector<std::string> splitBatchedFrame(std::string_view data, Encoding encoding)
+{
+    std::vector<std::string> messages;
+    if (encoding == Encoding::Binary) {
+        BinaryReader reader(data);
+        while (auto message = reader.string())
+            messages.emplace_back(*message);
+        return messages;
+    }
+
+    size_t pos;
+    while ((pos = data.find('\n')) != std::string_view::npos) {
+        messages.emplace_back(data.substr(0, pos));
+        data.remove_prefix(pos + 1);
+    }
+    messages.emplace_back(data);
+    return messages;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "common/out_message.h"
+#include "server_stats.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+// The last rendered GAME_LIST in each encoding, shared by every session. An entry rendered at some
+// lobby version serves all the requests made at that version, so polling clients don't render the
+// same bytes over and over.
+class LobbyCache {
+public:
+    explicit LobbyCache(std::shared_ptr<ServerStats> stats)
+        : stats_(std::move(stats))
+    {}
+
+    // version must be read before the lobby is listed by render, so the rendered lobby is at least
+    // as new as the version it is stored under
+    template <typename Render>
+    SharedBuffer get(Encoding encoding, uint64_t version, Render&& render)
+    {
+        auto& slot = entries_[static_cast<size_t>(encoding)];
+        auto entry = slot.load(std::memory_order_acquire);
+        if (entry && entry->version >= version) {
+            stats_->lobbyCacheHits.fetch_add(1, std::memory_order_relaxed);
+            return entry->data;
+        }
+
+        stats_->lobbyCacheMisses.fetch_add(1, std::memory_order_relaxed);
+        auto fresh = std::make_shared<const Entry>(Entry{ version, std::make_shared<const std::string>(render()) });
+        // A slower render of an older version doesn't replace a newer one
+        while (!(entry && entry->version >= version)) {
+            if (slot.compare_exchange_weak(entry, fresh, std::memory_order_acq_rel, std::memory_order_acquire))
+                break;
+        }
+        return fresh->data;
+    }
+
+private:
+    struct Entry {
+        uint64_t version;
+        SharedBuffer data;
+    };
+
+    std::shared_ptr<ServerStats> stats_;
+    std::array<std::atomic<std::shared_ptr<const Entry>>, 2> entries_;
+};
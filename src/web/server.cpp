@@ -9,40 +9,90 @@
 
 namespace ws = boost::beast::websocket;
 
-Server::Server(size_t threadCount, size_t port)
+namespace {
+
+std::vector<std::unique_ptr<boost::asio::io_context>> makeShards(size_t count, int concurrencyHint)
+{
+    std::vector<std::unique_ptr<boost::asio::io_context>> shards;
+    for (size_t i = 0; i < std::max<size_t>(count, 1); ++i)
+        shards.push_back(std::make_unique<boost::asio::io_context>(concurrencyHint));
+    return shards;
+}
+
+} // namespace
+
+Server::Server(size_t threadCount, size_t port, ServerOptions options)
     : pool_(threadCount)
-    , acceptor_(ioc_)
+    , shards_(options.sharded ? makeShards(threadCount, 1) : makeShards(1, static_cast<int>(threadCount)))
+    , nextShard_(0)
+    , ratedMatchTimer_(*shards_[0])
+    , reapTimer_(*shards_[0])
     , playerManager_(std::make_shared<PlayerManager>())
-    , gameManager_(std::make_shared<GameManager>())
+    , gameManager_(std::make_shared<GameManager>(options.lockFreeGames, options.gameShards,
+                                                 GameManager::DEFAULT_MATCH_QUEUE_CAPACITY, options.ratingWindow,
+                                                 options.epochReads))
+    , stats_(std::make_shared<ServerStats>())
+    , lobbyCache_(std::make_shared<LobbyCache>(stats_))
+    , mcts_(options.botThreads ? std::make_shared<Mcts>(options.botThreads, options.mcts) : nullptr)
     , threadCount_(threadCount)
     , port_(port)
-{}
+    , options_(options)
+{
+#ifndef SO_REUSEPORT
+    // A second acceptor couldn't bind the same endpoint
+    if (options_.reusePort) {
+        std::cerr << "SO_REUSEPORT is not supported, listening with a single acceptor" << std::endl;
+        options_.reusePort = false;
+    }
+#endif
+    size_t acceptorCount = options_.reusePort ? threadCount_ : 1;
+    for (size_t i = 0; i < acceptorCount; ++i)
+        acceptors_.emplace_back(*shards_[i % shards_.size()]);
+}
 
 void Server::start()
 {
     for (int i = 0; i < threadCount_; ++i) {
-        boost::asio::post(pool_, [this](){
-            auto workGuard = boost::asio::make_work_guard(ioc_);
-            ioc_.run();
+        auto& ioc = *shards_[i % shards_.size()];
+        boost::asio::post(pool_, [&ioc](){
+            auto workGuard = boost::asio::make_work_guard(ioc);
+            ioc.run();
         });
     }
 
     ip::tcp::endpoint endpoint(ip::tcp::v4(), port_);
-    acceptor_.open(endpoint.protocol());
-    acceptor_.set_option(ip::tcp::acceptor::reuse_address(true));
-    acceptor_.bind(endpoint);
-    acceptor_.listen();
-
-    onAcceptAsync();
+    for (auto& acceptor : acceptors_) {
+        listen(acceptor, endpoint);
+        onAcceptAsync(acceptor);
+    }
+    scheduleRatedMatching();
+    scheduleReaping();
     pool_.join();
 }
 
-void Server::onAcceptAsync()
+void Server::listen(ip::tcp::acceptor& acceptor, const ip::tcp::endpoint& endpoint)
+{
+    acceptor.open(endpoint.protocol());
+    acceptor.set_option(ip::tcp::acceptor::reuse_address(true));
+    if (options_.reusePort) {
+#ifdef SO_REUSEPORT
+        acceptor.set_option(boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>(true));
+#endif
+    }
+    acceptor.bind(endpoint);
+    acceptor.listen();
+}
+
+void Server::onAcceptAsync(ip::tcp::acceptor& acceptor)
 {
-    auto ws = std::make_shared<ws::stream<boost::beast::tcp_stream>>(ioc_);
+    // The stream is bound to a strand of its shard, so the whole session lifetime stays on that shard's
+    // thread and its reads, writes and notifications never run concurrently.
+    // With SO_REUSEPORT the kernel has already picked the shard by picking the acceptor.
+    auto& ioc = options_.reusePort ? static_cast<boost::asio::io_context&>(acceptor.get_executor().context()) : nextShard();
+    auto ws = std::make_shared<ws::stream<boost::beast::tcp_stream>>(boost::asio::make_strand(ioc));
     ws->set_option(ws::stream_base::timeout::suggested(boost::beast::role_type::server));
 
-    acceptor_.async_accept(boost::beast::get_lowest_layer(*ws).socket(), [this, ws](boost::system::error_code ec)
+    acceptor.async_accept(boost::beast::get_lowest_layer(*ws).socket(), [this, ws, &acceptor](boost::system::error_code ec)
         {
             if (ec) {
                 if (ec == boost::asio::error::operation_aborted) {
@@ -52,11 +102,52 @@ void Server::onAcceptAsync()
                 std::cerr << ec.message() << std::endl;
                 return;
             }
-            std::make_shared<Session>(ws, playerManager_, gameManager_)->start();
-            onAcceptAsync();
+            auto session = std::make_shared<Session>(ws, playerManager_, gameManager_, stats_, lobbyCache_, options_.writeQueue, mcts_);
+            if (options_.coroutines)
+                session->startCoroutine();
+            else
+                session->start();
+            onAcceptAsync(acceptor);
+        });
+}
+
+boost::asio::io_context& Server::nextShard()
+{
+    return *shards_[nextShard_.fetch_add(1, std::memory_order_relaxed) % shards_.size()];
+}
+
+void Server::scheduleRatedMatching()
+{
+    ratedMatchTimer_.expires_after(options_.ratedMatchInterval);
+    ratedMatchTimer_.async_wait([this](boost::system::error_code ec)
+        {
+            if (ec)
+                return;
+            gameManager_->matchRatedPlayers();
+            scheduleRatedMatching();
+        });
+}
+
+void Server::scheduleReaping()
+{
+    reapTimer_.expires_after(options_.reapInterval);
+    reapTimer_.async_wait([this](boost::system::error_code ec)
+        {
+            if (ec)
+                return;
+            auto reaped = gameManager_->reapGames(options_.reapBudget, options_.emptyGameGrace);
+            stats_->reapedOverGames.fetch_add(reaped.over, std::memory_order_relaxed);
+            stats_->reapedEmptyGames.fetch_add(reaped.empty, std::memory_order_relaxed);
+            scheduleReaping();
         });
 }
 
+const ServerStats& Server::stats() const
+{
+    return *stats_;
+}
+
 void Server::stop() {
-    ioc_.stop();
+    for (auto& ioc : shards_)
+        ioc->stop();
 }
@@ -2,28 +2,83 @@
 
 #include "../game/player_manager.h"
 #include "../game/game_manager.h"
+#include "../game/mcts.h"
+#include "lobby_cache.h"
+#include "server_stats.h"
+#include "write_queue.h"
 
 #include <boost/asio.hpp>
 #include <boost/beast.hpp>
 
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+
 namespace ip = boost::asio::ip;
 
+struct ServerOptions {
+    // Every worker thread runs its own io_context and accepted sockets are spread round-robin
+    // between them. Otherwise all threads share a single io_context.
+    bool sharded = false;
+    // One SO_REUSEPORT acceptor per worker thread, so the kernel spreads incoming connections.
+    // Connections accepted by an acceptor stay on the acceptor's io_context. Ignored where
+    // SO_REUSEPORT is not supported, a single acceptor listens there.
+    bool reusePort = false;
+    // Classic games apply moves with a CAS on a packed state word instead of the game mutex
+    bool lockFreeGames = false;
+    // Independently locked parts of the game registry
+    size_t gameShards = GameManager::DEFAULT_SHARD_COUNT;
+    // Games are looked up without the registry locks, see EpochDomain. Off, every MOVE and LEAVE
+    // takes a shard lock and a reference to the game.
+    bool epochReads = false;
+    // Sessions run as coroutines instead of callback chains. They copy no session reference per
+    // operation, but make more allocations per message than callbacks, see Session::run.
+    bool coroutines = false;
+    // Per-session bound on messages waiting to be written to a client that does not keep up
+    WriteQueueLimits writeQueue;
+    // Threads searching the moves of bots on large boards, shared by all their games. 0: no such bots.
+    size_t botThreads = 1;
+    MctsOptions mcts;
+    // How often players waiting for a rated match are paired once their windows have grown
+    std::chrono::milliseconds ratedMatchInterval{250};
+    RatingWindow ratingWindow;
+    // How often the reaper sweeps the registry, and how many of its slots one sweep visits
+    std::chrono::milliseconds reapInterval{1000};
+    size_t reapBudget = 4096;
+    // Age at which a game nobody joined is reaped
+    std::chrono::milliseconds emptyGameGrace{60000};
+};
+
 class Server {
 public:
-    Server(size_t threadCount, size_t port);
+    Server(size_t threadCount, size_t port, ServerOptions options = {});
     void start();
     void stop();
 
+    const ServerStats& stats() const;
+
 private:
-    void onAcceptAsync();
+    void listen(ip::tcp::acceptor& acceptor, const ip::tcp::endpoint& endpoint);
+    void onAcceptAsync(ip::tcp::acceptor& acceptor);
+    boost::asio::io_context& nextShard();
+    void scheduleRatedMatching();
+    void scheduleReaping();
 
     boost::asio::thread_pool pool_;
-    boost::asio::io_context ioc_;
-    ip::tcp::acceptor acceptor_;
+    std::vector<std::unique_ptr<boost::asio::io_context>> shards_;
+    std::atomic<size_t> nextShard_;
+    std::vector<ip::tcp::acceptor> acceptors_;
+    boost::asio::steady_timer ratedMatchTimer_;
+    boost::asio::steady_timer reapTimer_;
 
     std::shared_ptr<PlayerManager> playerManager_;
     std::shared_ptr<GameManager> gameManager_;
+    std::shared_ptr<ServerStats> stats_;
+    std::shared_ptr<LobbyCache> lobbyCache_;
+    std::shared_ptr<Mcts> mcts_;
 
     size_t threadCount_;
     size_t port_;
+    ServerOptions options_;
 };
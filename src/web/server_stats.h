@@ -0,0 +1,40 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+struct ServerStats {
+    // One write op is one async_write on a session socket. With batching enabled a single write
+    // carries every message that was queued when it started.
+    std::atomic<uint64_t> writeOps{0};
+    std::atomic<uint64_t> writtenMessages{0};
+
+    // Gauges over every session's write queue
+    std::atomic<uint64_t> queuedBytes{0};
+    std::atomic<uint64_t> queuedMessages{0};
+    // Slow consumers: lobby messages dropped or replaced by a newer one, connections closed on overflow
+    std::atomic<uint64_t> droppedMessages{0};
+    std::atomic<uint64_t> mergedMessages{0};
+    std::atomic<uint64_t> slowConsumerCloses{0};
+
+    // Full GAME_LIST requests answered from the rendered lobby cache, and the ones that had to render it
+    std::atomic<uint64_t> lobbyCacheHits{0};
+    std::atomic<uint64_t> lobbyCacheMisses{0};
+
+    // Games the reaper removed from the registry: finished ones nobody removed, and ones nobody joined
+    std::atomic<uint64_t> reapedOverGames{0};
+    std::atomic<uint64_t> reapedEmptyGames{0};
+
+    double messagesPerWrite() const
+    {
+        auto ops = writeOps.load(std::memory_order_relaxed);
+        return ops ? static_cast<double>(writtenMessages.load(std::memory_order_relaxed)) / ops : 0.0;
+    }
+
+    double lobbyCacheHitRate() const
+    {
+        auto hits = lobbyCacheHits.load(std::memory_order_relaxed);
+        auto total = hits + lobbyCacheMisses.load(std::memory_order_relaxed);
+        return total ? static_cast<double>(hits) / total : 0.0;
+    }
+};
@@ -1,31 +1,108 @@
 #include "session.h"
 #include "common/command_code.h"
+#include "common/command_parser.h"
+#include "common/out_message.h"
 
-#include <boost/algorithm/string.hpp>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/use_awaitable.hpp>
 #include <boost/uuid/uuid_io.hpp>
-#include <boost/format.hpp>
 
+#include <algorithm>
 #include <thread>
 #include <iostream>
+#include <string_view>
 #include <utility>
 
+namespace {
+
+// Nicknames reach clients of both encodings. Text frames separate fields with ' ' and '|', and
+// batched messages with '\n', so none of them, nor other control characters, may be in a nickname.
+bool isValidNickname(std::string_view nickname)
+{
+    return !nickname.empty() && std::ranges::none_of(nickname, [](unsigned char c)
+        {
+            return c <= ' ' || c == '|' || c == 0x7f;
+        });
+}
+
+// The same notification goes to every player of the game, one recipient after the other on the
+// notifying thread. The last one serialized is kept per thread, with its wire bytes in each encoding,
+// and the next recipient of an equal notification shares those bytes.
+struct RenderedNotification {
+    Notification source;
+    std::array<SharedBuffer, 2> buffers;
+};
+
+thread_local std::optional<RenderedNotification> lastNotification;
+
+} // namespace
+
+// Indexed by InCommandCode
+const std::array<Session::CommandHandler, IN_COMMAND_COUNT> Session::commandHandlers_ = {
+    &Session::onAuth,
+    &Session::onCreateGame,
+    &Session::onGetGames,
+    &Session::onJoinGame,
+    &Session::onLeaveGame,
+    &Session::onMove,
+    &Session::onQuickMatch,
+};
+
 Session::Session(std::shared_ptr<ws::stream<boost::beast::tcp_stream>> ws,
                  std::shared_ptr<PlayerManager> playerManager,
-                 std::shared_ptr<GameManager> gameManager)
+                 std::shared_ptr<GameManager> gameManager,
+                 std::shared_ptr<ServerStats> stats,
+                 std::shared_ptr<LobbyCache> lobbyCache,
+                 WriteQueueLimits writeLimits,
+                 std::shared_ptr<Mcts> mcts)
     : ws_(std::move(ws))
+    , writeMessages_(writeLimits, stats)
+    , flushPending_(false)
+    , closing_(false)
+    , coroutine_(false)
+    , writerIdle_(false)
+    , writeSignal_(ws_->get_executor(), std::chrono::steady_clock::time_point::max())
     , playerManager_(playerManager)
     , gameManager_(gameManager)
+    , stats_(stats)
+    , lobbyCache_(std::move(lobbyCache))
+    , mcts_(std::move(mcts))
 {}
 
 Session::~Session()
 {
+    cancelQuickMatch();
     if (player_)
         gameManager_->leavePlayerFromGame(player_);
 }
 
 void Session::start()
 {
-    ws_->async_accept([self = shared_from_this(), ws = ws_](const boost::beast::error_code& ec) {
+    // The upgrade request is read by hand so protocol options can be taken from its target
+    boost::beast::get_lowest_layer(*ws_).expires_after(std::chrono::seconds(30));
+    http::async_read(ws_->next_layer(), buf_, upgradeRequest_, [self = shared_from_this()](boost::beast::error_code ec, std::size_t)
+        {
+            if (ec) {
+                if (ec == boost::asio::error::operation_aborted) {
+                    return;
+                }
+                std::cerr << ec.message() << std::endl;
+                return;
+            }
+
+            auto target = self->upgradeRequest_.target();
+            self->options_ = parseHandshakeOptions(std::string_view(target.data(), target.size()));
+            boost::beast::get_lowest_layer(*self->ws_).expires_never();
+            self->onAcceptAsync();
+        });
+}
+
+void Session::onAcceptAsync()
+{
+    ws_->async_accept(upgradeRequest_, [self = shared_from_this(), ws = ws_](const boost::beast::error_code& ec) {
         if (ec) {
             if (ec == boost::asio::error::operation_aborted) {
                 return;
@@ -34,6 +111,7 @@ void Session::start()
             return;
         }
 
+        self->upgradeRequest_ = {};
         self->onReadAsync();
     });
 }
@@ -54,26 +132,61 @@ void Session::onReadAsync()
                 return;
             }
 
-            auto data = boost::beast::buffers_to_string(self->buf_.data());
-            self->buf_.consume(self->buf_.size());
-
-            auto answer = processCommand(data, self);
-            if (!answer.empty())
-                self->writeAsync(answer);
+            onInCommand(self);
             self->onReadAsync();
         });
 }
 
+void Session::onInCommand(const std::shared_ptr<Session>& self)
+{
+    // flat_buffer keeps the frame contiguous, so it is parsed in place
+    auto data = self->buf_.data();
+    auto answer = processCommand(std::string_view(static_cast<const char*>(data.data()), data.size()), self);
+    self->buf_.consume(self->buf_.size());
+
+    if (answer.data)
+        self->writeAsync(std::move(answer.data), answer.kind);
+}
+
+boost::asio::const_buffer Session::prepareWrite()
+{
+    // With batching every queued message goes out in one frame, otherwise one message per frame
+    boost::asio::const_buffer buffer;
+    bool binary = options_.encoding == Encoding::Binary;
+    if (options_.batch && (binary || writeMessages_.size() > 1)) {
+        writeBatch_.clear();
+        for (const auto& message : writeMessages_) {
+            if (binary)
+                writeVarint(writeBatch_, message.data->size());
+            else if (!writeBatch_.empty())
+                writeBatch_ += '\n';
+            writeBatch_ += *message.data;
+        }
+        writeMessages_.startWrite(writeMessages_.size());
+        buffer = boost::asio::buffer(writeBatch_);
+    } else {
+        writeMessages_.startWrite(1);
+        buffer = boost::asio::buffer(*writeMessages_.front().data);
+    }
+    stats_->writeOps.fetch_add(1, std::memory_order_relaxed);
+    stats_->writtenMessages.fetch_add(writeMessages_.inFlight(), std::memory_order_relaxed);
+
+    if (binary)
+        ws_->binary(true);
+    else
+        ws_->text(ws_->got_text());
+    return buffer;
+}
+
 void Session::onWriteAsync()
 {
     if (writeMessages_.empty())
         return;
-    ws_->text(ws_->got_text());
-    ws_->async_write(boost::asio::buffer(writeMessages_.front()), [self = shared_from_this()](boost::system::error_code ec, size_t)
+
+    ws_->async_write(prepareWrite(), [self = shared_from_this()](boost::system::error_code ec, size_t)
         {
-            std::lock_guard lock(self->writeMessagesMutex_);
-            self->writeMessages_.pop_front();
-            if (!self->writeMessages_.empty())
+            self->writeMessages_.finishWrite();
+            if (!self->writeMessages_.empty() && !self->closing_)
                 self->onWriteAsync();
 
             if (ec) {
@@ -85,134 +198,372 @@ void Session::onWriteAsync()
         });
 }
 
-void Session::writeAsync(const std::string& message)
+void Session::writeAsync(SharedBuffer message, MessageKind kind)
 {
-    std::lock_guard lock(writeMessagesMutex_);
-    writeMessages_.push_back(message);
-    if (writeMessages_.size() == 1)
+    if (closing_)
+        return;
+    if (!writeMessages_.push(std::move(message), kind)) {
+        closeSlowConsumer();
+        return;
+    }
+    if (coroutine_) {
+        if (writerIdle_)
+            writeSignal_.cancel();
+        return;
+    }
+    if (writeMessages_.inFlight() != 0 || flushPending_)
+        return;
+
+    if (!options_.batch) {
         onWriteAsync();
+        return;
+    }
+
+    // Defer the flush so that everything queued by the current handler (and by notification
+    // handlers already waiting on the strand) goes out in one write
+    flushPending_ = true;
+    boost::asio::post(ws_->get_executor(), [self = shared_from_this()]()
+        {
+            self->flushPending_ = false;
+            if (self->writeMessages_.inFlight() == 0 && !self->closing_)
+                self->onWriteAsync();
+        });
 }
 
-std::string Session::processCommand(const std::string& command, std::shared_ptr<Session> session)
+void Session::closeSlowConsumer()
 {
-    std::stringstream ss;
-    std::vector<std::string> parts;
-    boost::split(parts, command, boost::is_any_of(" "));
+    // A graceful close would queue behind the writes the client is not reading, so the socket is
+    // closed outright. Pending reads and writes fail and the session goes away with them.
+    closing_ = true;
+    stats_->slowConsumerCloses.fetch_add(1, std::memory_order_relaxed);
+    std::cerr << "closing slow consumer, " << writeMessages_.bytes() << " bytes queued" << std::endl;
+    boost::beast::get_lowest_layer(*ws_).close();
+    writeSignal_.cancel();
+}
+
+void Session::startCoroutine()
+{
+    coroutine_ = true;
+    boost::asio::co_spawn(ws_->get_executor(), run(shared_from_this()), boost::asio::detached);
+}
+
+// Both coroutines own one reference to the session for their whole lifetime instead of copying it
+// into every completion handler. Frames are not recycled per session: asio allocates them, and the
+// frame of every use_awaitable operation, from a per-thread cache that holds a single block, and
+// this asio version offers no hook to plug another allocator into co_spawn or use_awaitable. So
+// the coroutine path allocates more per message than the callback one.
+boost::asio::awaitable<void> Session::run(std::shared_ptr<Session> self)
+{
+    boost::beast::error_code ec;
+    auto token = boost::asio::redirect_error(boost::asio::use_awaitable, ec);
+
+    boost::beast::get_lowest_layer(*self->ws_).expires_after(std::chrono::seconds(30));
+    co_await http::async_read(self->ws_->next_layer(), self->buf_, self->upgradeRequest_, token);
+    if (!ec) {
+        auto target = self->upgradeRequest_.target();
+        self->options_ = parseHandshakeOptions(std::string_view(target.data(), target.size()));
+        boost::beast::get_lowest_layer(*self->ws_).expires_never();
+        co_await self->ws_->async_accept(self->upgradeRequest_, token);
+    }
+    if (ec) {
+        if (ec != boost::asio::error::operation_aborted)
+            std::cerr << ec.message() << std::endl;
+        co_return;
+    }
 
-    try {
-        auto code = static_cast<InCommandCode>(std::stoi(parts[0]));
+    self->upgradeRequest_ = {};
+    boost::asio::co_spawn(self->ws_->get_executor(), writeLoop(self), boost::asio::detached);
 
-        if (code != InCommandCode::AUTH && !session->player_) {
-            ss << OutCommandCode::ERROR << ' ' << ErrorCode::ERROR_NOT_AUTH;
-            return ss.str();
+    while (true) {
+        co_await self->ws_->async_read(self->buf_, token);
+        if (ec)
+            break;
+        onInCommand(self);
+    }
+
+    if (ec == ws::error::closed)
+        std::cout << "client socket shutdown" << std::endl;
+    else if (ec != boost::asio::error::operation_aborted)
+        std::cerr << ec.message() << std::endl;
+
+    // Wake the writer so that it lets go of the session
+    self->closing_ = true;
+    self->writeSignal_.cancel();
+}
+
+boost::asio::awaitable<void> Session::writeLoop(std::shared_ptr<Session> self)
+{
+    boost::beast::error_code ec;
+    auto token = boost::asio::redirect_error(boost::asio::use_awaitable, ec);
+
+    while (!self->closing_) {
+        if (self->writeMessages_.empty()) {
+            self->writerIdle_ = true;
+            co_await self->writeSignal_.async_wait(token);
+            self->writerIdle_ = false;
+            // Give everything queued by handlers already waiting on the strand a chance to join the batch
+            if (self->options_.batch)
+                co_await boost::asio::post(self->ws_->get_executor(), boost::asio::use_awaitable);
+            continue;
         }
 
-        switch (code) {
-            case AUTH: {
-                if (session->player_) {
-                    ss << OutCommandCode::ERROR << ' ' << ErrorCode::ERROR_ALREADY_AUTH;
-                    break;
-                }
-                if (parts.size() < 2) {
-                    ss << OutCommandCode::ERROR << ' ' << ErrorCode::INCORRECT_FORMAT;
-                    break;
-                }
-                session->player_ = session->playerManager_->createPlayer(parts[1]);
-                session->player_->setNotificationHandler([weakSelf = std::weak_ptr(session)](const Notification& notification)
-                    {
-                        if (auto self = weakSelf.lock())
-                            self->writeAsync(processNotification(notification, self));
-                    });
-
-                ss << OutCommandCode::PLAYER_AUTHED << ' ' << session->player_->id();
-                break;
-            }
-            case CREATE_GAME: {
-                if (session->player_->isInGame()) {
-                    ss << OutCommandCode::ERROR << ' ' << ErrorCode::ERROR_CREATE;
-                    break;
-                }
-                auto gameId = session->gameManager_->createGame();
-                bool res = session->gameManager_->addPlayerToGame(session->player_, gameId);
-                if (!res) {
-                    ss << OutCommandCode::ERROR << ' ' << ErrorCode::ERROR_CREATE;
-                } else {
-                    ss << OutCommandCode::GAME_CREATED << ' ' << gameId;
-                }
-                break;
-            }
-            case GET_GAMES: {
-                ss << OutCommandCode::GAME_LIST;
-                auto games = session->gameManager_->getWaitingGames();
-                for (const auto& game : games) {
-                    ss << ' ' << game->id() << '|' << game->player1()->nickname();
-                }
-                break;
-            }
-            case JOIN_GAME: {
-                auto gameId = std::stoul(parts[1]);
-                bool res = session->gameManager_->addPlayerToGame(session->player_, gameId);
-                auto game = session->gameManager_->getGame(gameId);
-                if (!res || !game) {
-                    ss << OutCommandCode::ERROR << ' ' << ErrorCode::ERROR_JOIN;
-                } else {
-                    ss << OutCommandCode::JOINED_GAME << ' ' << gameId << ' ' << game->player1()->nickname();
-                }
-                break;
-            }
-            case LEAVE_GAME: {
-                bool res = session->gameManager_->leavePlayerFromGame(session->player_);
-                if (!res) {
-                    ss << OutCommandCode::ERROR << ' ' << ErrorCode::ERROR_LEAVE;
-                } else {
-                    ss << OutCommandCode::LEFT_GAME;
-                }
-                break;
-            }
-            case MOVE: {
-                if (parts.size() < 3) {
-                    ss << OutCommandCode::ERROR << ' ' << ErrorCode::INCORRECT_FORMAT;
-                    break;
-                }
-                auto x = std::stoi(parts[1]);
-                auto y = std::stoi(parts[2]);
-                bool res = session->gameManager_->makeMove(session->player_, x, y);
-                if (!res) {
-                    ss << OutCommandCode::ERROR << ' ' << ErrorCode::ERROR_MOVE;
-                } else {
-                    return ""; // MOVES might sended by notification
-                }
-            }
-            default:
-                ss << OutCommandCode::ERROR << ' ' << ErrorCode::UNKNOWN_COMMAND;
+        co_await self->ws_->async_write(self->prepareWrite(), token);
+        self->writeMessages_.finishWrite();
+        if (ec) {
+            if (ec != boost::asio::error::operation_aborted)
+                std::cerr << ec.message() << std::endl;
+            co_return;
         }
-    } catch (std::exception& e) {
-        ss << OutCommandCode::ERROR << ' ' << ErrorCode::INCORRECT_FORMAT;
+    }
+}
+
+Session::Reply Session::processCommand(std::string_view command, const std::shared_ptr<Session>& session)
+{
+    CommandReader args(command, session->options_.encoding);
+    auto code = args.code();
+
+    CommandResult result = std::unexpected(ErrorCode::INCORRECT_FORMAT);
+    if (!code) {
+        // keep INCORRECT_FORMAT
+    } else if (*code != InCommandCode::AUTH && !session->player_) {
+        result = std::unexpected(ErrorCode::ERROR_NOT_AUTH);
+    } else if (*code < 0 || *code >= static_cast<int>(commandHandlers_.size())) {
+        result = std::unexpected(ErrorCode::UNKNOWN_COMMAND);
+    } else {
+        result = commandHandlers_[*code](session, args);
+    }
+
+    if (!result)
+        return OutMessage(session->options_.encoding, OutCommandCode::ERROR).number(result.error()).str();
+    return std::move(*result);
+}
+
+Session::CommandResult Session::onAuth(const std::shared_ptr<Session>& session, CommandReader& args)
+{
+    if (session->player_)
+        return std::unexpected(ErrorCode::ERROR_ALREADY_AUTH);
+    auto nickname = args.string();
+    if (!nickname || !isValidNickname(*nickname))
+        return std::unexpected(ErrorCode::INCORRECT_FORMAT);
+
+    session->player_ = session->playerManager_->createPlayer(std::string(*nickname));
+    // Notifications arrive on the thread of whoever changed the game, with the game lock held. The
+    // session is only locked on its own strand: dropping its last reference here would re-enter the
+    // game from ~Session.
+    session->player_->setNotificationHandler([weakSelf = std::weak_ptr(session), executor = session->ws_->get_executor(),
+                                              encoding = session->options_.encoding](const Notification& notification)
+        {
+            boost::asio::post(executor, [weakSelf, message = processNotification(notification, encoding)]() mutable
+                {
+                    if (auto self = weakSelf.lock())
+                        self->writeAsync(std::move(message));
+                });
+        });
+
+    return session->reply(OutCommandCode::PLAYER_AUTHED).number(session->player_->id()).str();
+}
+
+Session::CommandResult Session::onCreateGame(const std::shared_ptr<Session>& session, CommandReader& args)
+{
+    // Optional board size, win length and opponent: 3x3 with three in a row against a player by default
+    BoardRules rules;
+    auto opponent = Opponent::Player;
+    if (args.hasMore()) {
+        auto size = args.number<int>();
+        auto winLength = args.hasMore() ? args.number<int>() : size;
+        auto opponentCode = args.hasMore() ? args.number<int>() : 0;
+        if (!size || !winLength || !opponentCode || *opponentCode < 0 || *opponentCode > static_cast<int>(Opponent::Bot))
+            return std::unexpected(ErrorCode::INCORRECT_FORMAT);
+        rules = BoardRules{ .size = *size, .winLength = *winLength };
+        opponent = static_cast<Opponent>(*opponentCode);
+    }
+    if (!rules.isValid() || !session->cancelQuickMatch() || session->player_->isInGame())
+        return std::unexpected(ErrorCode::ERROR_CREATE);
+    if (opponent == Opponent::Bot && !rules.isClassic() && !session->mcts_)
+        return std::unexpected(ErrorCode::ERROR_CREATE);
+
+    auto gameId = session->gameManager_->createGame(rules);
+    if (!session->gameManager_->addPlayerToGame(session->player_, gameId))
+        return std::unexpected(ErrorCode::ERROR_CREATE);
+
+    // The bot's moves are made on this session's strand, where its opponent's commands run too
+    if (opponent == Opponent::Bot) {
+        auto executor = session->ws_->get_executor();
+        auto bot = rules.isClassic()
+            ? Bot::createPerfect(*session->playerManager_, session->gameManager_, executor)
+            : Bot::createMcts(*session->playerManager_, session->gameManager_, executor, session->mcts_, rules);
+        session->gameManager_->addPlayerToGame(bot, gameId);
     }
 
-    return ss.str();
+    return session->reply(OutCommandCode::GAME_CREATED).number(gameId).str();
+}
+
+// [limit [cursor]]: a page of at most limit games with ids after cursor. The last id of a page is
+// the cursor of the next one.
+Session::CommandResult Session::onGetGames(const std::shared_ptr<Session>& session, CommandReader& args)
+{
+    size_t limit = SIZE_MAX;
+    std::optional<Id> cursor;
+    if (args.hasMore()) {
+        auto limitArg = args.number<uint32_t>();
+        if (!limitArg || *limitArg == 0)
+            return std::unexpected(ErrorCode::INCORRECT_FORMAT);
+        limit = *limitArg;
+    }
+    if (args.hasMore()) {
+        cursor = args.number<Id>();
+        if (!cursor)
+            return std::unexpected(ErrorCode::INCORRECT_FORMAT);
+    }
+
+    // The whole lobby is what polling clients ask for, it is rendered once per lobby version
+    if (limit == SIZE_MAX && !cursor) {
+        auto version = session->gameManager_->lobbyVersion();
+        return Reply(session->lobbyCache_->get(session->options_.encoding, version,
+                                               [&session]() { return renderGameList(session, SIZE_MAX, std::nullopt); }),
+                     MessageKind::Lobby);
+    }
+
+    // Only a first page may be replaced by a newer one, later pages continue an earlier reply
+    return Reply(renderGameList(session, limit, cursor), cursor ? MessageKind::Critical : MessageKind::Lobby);
+}
+
+std::string Session::renderGameList(const std::shared_ptr<Session>& session, size_t limit, std::optional<Id> cursor)
+{
+    auto message = session->reply(OutCommandCode::GAME_LIST);
+    auto games = session->gameManager_->getWaitingGames(limit, cursor);
+    for (const auto& game : games) {
+        const auto& rules = game->rules();
+        if (rules.isClassic())
+            message.entry(game->id(), game->player1()->nickname());
+        else
+            message.entry(game->id(), game->player1()->nickname(), rules.size, rules.winLength);
+    }
+    return message.str();
 }
 
-std::string Session::processNotification(const Notification& notification, std::shared_ptr<Session> session)
+Session::CommandResult Session::onJoinGame(const std::shared_ptr<Session>& session, CommandReader& args)
 {
-    std::stringstream ss;
-    std::string opponentNickname = notification.playerNickname;
+    auto gameId = args.number<Id>();
+    if (!gameId)
+        return std::unexpected(ErrorCode::INCORRECT_FORMAT);
+
+    if (!session->cancelQuickMatch())
+        return std::unexpected(ErrorCode::ERROR_JOIN);
+
+    bool res = session->gameManager_->addPlayerToGame(session->player_, *gameId);
+    auto game = session->gameManager_->getGame(*gameId);
+    if (!res || !game)
+        return std::unexpected(ErrorCode::ERROR_JOIN);
+
+    // Classic games keep the original reply, other boards append their size and win length
+    auto message = session->reply(OutCommandCode::JOINED_GAME).number(*gameId).string(game->player1()->nickname());
+    if (!game->rules().isClassic())
+        message.number(game->rules().size).number(game->rules().winLength);
+    return message.str();
+}
+
+Session::CommandResult Session::onLeaveGame(const std::shared_ptr<Session>& session, CommandReader&)
+{
+    // Leaving the quick-match queue before being paired
+    if (session->matchTicket_ && session->matchTicket_->isWaiting() && session->cancelQuickMatch())
+        return session->reply(OutCommandCode::LEFT_GAME).str();
+
+    if (!session->gameManager_->leavePlayerFromGame(session->player_))
+        return std::unexpected(ErrorCode::ERROR_LEAVE);
+
+    return session->reply(OutCommandCode::LEFT_GAME).str();
+}
+
+Session::CommandResult Session::onMove(const std::shared_ptr<Session>& session, CommandReader& args)
+{
+    auto move = args.move();
+    if (!move)
+        return std::unexpected(ErrorCode::INCORRECT_FORMAT);
+
+    if (!session->gameManager_->makeMove(session->player_, move->first, move->second))
+        return std::unexpected(ErrorCode::ERROR_MOVE);
+
+    return std::string(); // MOVES might sended by notification
+}
+
+// [rated]: 1 pairs by rating. Paired at once: JOINED_GAME like a JOIN_GAME reply. Otherwise
+// MATCH_QUEUED, then OPPONENT_JOINED when an opponent is found, as after creating a game. A rated
+// player the matcher pairs later may get the second seat instead, it is then sent JOINED_GAME.
+Session::CommandResult Session::onQuickMatch(const std::shared_ptr<Session>& session, CommandReader& args)
+{
+    bool rated = false;
+    if (args.hasMore()) {
+        auto ratedArg = args.number<int>();
+        if (!ratedArg || *ratedArg < 0 || *ratedArg > 1)
+            return std::unexpected(ErrorCode::INCORRECT_FORMAT);
+        rated = *ratedArg == 1;
+    }
+    if (session->matchTicket_ && session->matchTicket_->isWaiting())
+        return std::unexpected(ErrorCode::ERROR_JOIN);
+    if (!session->cancelQuickMatch())
+        return std::unexpected(ErrorCode::ERROR_JOIN);
+
+    auto match = rated ? session->gameManager_->ratedMatch(session->player_)
+                       : session->gameManager_->quickMatch(session->player_);
+    if (!match)
+        return std::unexpected(ErrorCode::ERROR_JOIN);
+
+    if (auto ticket = std::get_if<std::shared_ptr<MatchTicket>>(&*match)) {
+        session->matchTicket_ = std::move(*ticket);
+        return session->reply(OutCommandCode::MATCH_QUEUED).str();
+    }
+
+    auto gameId = std::get<Id>(*match);
+    auto game = session->gameManager_->getGame(gameId);
+    if (!game)
+        return std::unexpected(ErrorCode::ERROR_JOIN);
+    return session->reply(OutCommandCode::JOINED_GAME).number(gameId).string(game->player1()->nickname()).str();
+}
+
+bool Session::cancelQuickMatch()
+{
+    if (matchTicket_ && !matchTicket_->cancel())
+        return false;
+    matchTicket_.reset();
+    return true;
+}
+
+SharedBuffer Session::processNotification(const Notification& notification, Encoding encoding)
+{
+    if (!lastNotification || lastNotification->source != notification)
+        lastNotification = RenderedNotification{ .source = notification };
+    auto& rendered = lastNotification->buffers[static_cast<size_t>(encoding)];
+    if (!rendered)
+        rendered = std::make_shared<const std::string>(renderNotification(notification, encoding));
+    return rendered;
+}
+
+std::string Session::renderNotification(const Notification& notification, Encoding encoding)
+{
+    const std::string& opponentNickname = notification.playerNickname;
     switch (notification.type) {
         case Notification::Type::PlayerJoined:
-            ss << OutCommandCode::OPPONENT_JOINED << ' ' << opponentNickname;
-            break;
+            return OutMessage(encoding, OutCommandCode::OPPONENT_JOINED).string(opponentNickname).str();
+        case Notification::Type::MatchFound:
+            return OutMessage(encoding, OutCommandCode::JOINED_GAME).number(notification.gameId).string(opponentNickname).str();
         case Notification::Type::PlayerLeft:
-            ss << OutCommandCode::GAME_ENDED << ' ' << GameEndedCode::OPPONENT_LEFT;
-            break;
+            return OutMessage(encoding, OutCommandCode::GAME_ENDED).number(GameEndedCode::OPPONENT_LEFT).str();
         case Notification::Type::PlayerMoved:
-            ss << OutCommandCode::MOVED << ' ' << notification.extraInfo << ' ' << opponentNickname;
-            break;
+            return OutMessage(encoding, OutCommandCode::MOVED)
+                    .move(notification.x, notification.y, notification.mark)
+                    .string(opponentNickname)
+                    .str();
         case Notification::Type::GameEnded:
-            ss << OutCommandCode::GAME_ENDED << ' ';
-            if (opponentNickname.empty()) ss << GameEndedCode::DRAW;
-            else ss << GameEndedCode::WIN << ' ' << opponentNickname;
-            break;
+            if (opponentNickname.empty())
+                return OutMessage(encoding, OutCommandCode::GAME_ENDED).number(GameEndedCode::DRAW).str();
+            return OutMessage(encoding, OutCommandCode::GAME_ENDED).number(GameEndedCode::WIN).string(opponentNickname).str();
     }
 
-    return ss.str();
+    return {};
+}
+
+OutMessage Session::reply(OutCommandCode code) const
+{
+    return OutMessage(options_.encoding, code);
 }
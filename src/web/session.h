@@ -1,46 +1,121 @@
 #pragma once
 
+#include "../game/bot.h"
 #include "../game/player.h"
 #include "../game/game_manager.h"
 #include "../game/player_manager.h"
+#include "common/command_code.h"
+#include "common/command_parser.h"
+#include "common/out_message.h"
+#include "common/handshake.h"
+#include "lobby_cache.h"
+#include "server_stats.h"
+#include "write_queue.h"
 
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/beast.hpp>
 #include <boost/beast/websocket.hpp>
 #include <boost/uuid/string_generator.hpp>
 
+#include <array>
+#include <expected>
 #include <iostream>
-#include <deque>
 #include <memory>
 
 namespace ws = boost::beast::websocket;
+namespace http = boost::beast::http;
 
 class Session : public std::enable_shared_from_this<Session> {
 public:
     explicit Session(
             std::shared_ptr<ws::stream<boost::beast::tcp_stream>> ws,
             std::shared_ptr<PlayerManager> player,
-            std::shared_ptr<GameManager> gameManager);
+            std::shared_ptr<GameManager> gameManager,
+            std::shared_ptr<ServerStats> stats,
+            std::shared_ptr<LobbyCache> lobbyCache,
+            WriteQueueLimits writeLimits = {},
+            std::shared_ptr<Mcts> mcts = nullptr);
     ~Session();
 
     void start();
+    // Same protocol as start(), driven by coroutines instead of callback chains
+    void startCoroutine();
 
 private:
+    void onAcceptAsync();
     void onReadAsync();
     void onWriteAsync();
-    void writeAsync(const std::string& message);
 
-    static std::string processCommand(const std::string& command, std::shared_ptr<Session> session);
-    static std::string processNotification(const Notification& notification, std::shared_ptr<Session> session);
+    static boost::asio::awaitable<void> run(std::shared_ptr<Session> self);
+    static boost::asio::awaitable<void> writeLoop(std::shared_ptr<Session> self);
+
+    // Moves the queued messages into a write, batching them if the client asked for it
+    boost::asio::const_buffer prepareWrite();
+    static void onInCommand(const std::shared_ptr<Session>& self);
+    // Must be called on the session's strand
+    void writeAsync(SharedBuffer message, MessageKind kind = MessageKind::Critical);
+    void closeSlowConsumer();
+
+    struct Reply {
+        // An empty reply sends nothing
+        Reply(std::string data, MessageKind kind = MessageKind::Critical)
+            : data(data.empty() ? nullptr : std::make_shared<const std::string>(std::move(data))), kind(kind)
+        {}
+        Reply(SharedBuffer data, MessageKind kind = MessageKind::Critical)
+            : data(std::move(data)), kind(kind)
+        {}
+
+        SharedBuffer data;
+        MessageKind kind;
+    };
+
+    using CommandResult = std::expected<Reply, ErrorCode>;
+    using CommandHandler = CommandResult (*)(const std::shared_ptr<Session>& session, CommandReader& args);
+
+    static Reply processCommand(std::string_view command, const std::shared_ptr<Session>& session);
+    static CommandResult onAuth(const std::shared_ptr<Session>& session, CommandReader& args);
+    static CommandResult onCreateGame(const std::shared_ptr<Session>& session, CommandReader& args);
+    static CommandResult onGetGames(const std::shared_ptr<Session>& session, CommandReader& args);
+    static CommandResult onJoinGame(const std::shared_ptr<Session>& session, CommandReader& args);
+    static CommandResult onLeaveGame(const std::shared_ptr<Session>& session, CommandReader& args);
+    static CommandResult onMove(const std::shared_ptr<Session>& session, CommandReader& args);
+    static CommandResult onQuickMatch(const std::shared_ptr<Session>& session, CommandReader& args);
+    // False while the player is being paired and can't take another way into a game
+    bool cancelQuickMatch();
+
+    static std::string renderGameList(const std::shared_ptr<Session>& session, size_t limit, std::optional<Id> cursor);
+    static SharedBuffer processNotification(const Notification& notification, Encoding encoding);
+    static std::string renderNotification(const Notification& notification, Encoding encoding);
+
+    OutMessage reply(OutCommandCode code) const;
+
+    static const std::array<CommandHandler, IN_COMMAND_COUNT> commandHandlers_;
 
     std::shared_ptr<ws::stream<boost::beast::tcp_stream>> ws_;
     boost::beast::flat_buffer buf_;
+    http::request<http::string_body> upgradeRequest_;
+    HandshakeOptions options_;
 
-    std::mutex writeMessagesMutex_;
-    std::deque<std::string> writeMessages_;
+    // Only touched on the stream's strand
+    WriteQueue writeMessages_;
+    std::string writeBatch_;
+    bool flushPending_;
+    bool closing_;
+    // Coroutine variant: the writer sleeps on the timer while the queue is empty
+    bool coroutine_;
+    bool writerIdle_;
+    boost::asio::steady_timer writeSignal_;
 
     std::shared_ptr<Player> player_;
+    // Set while the player waits in the quick-match queue, and after it has been paired
+    std::shared_ptr<MatchTicket> matchTicket_;
     std::shared_ptr<PlayerManager> playerManager_;
     std::shared_ptr<GameManager> gameManager_;
+    std::shared_ptr<ServerStats> stats_;
+    std::shared_ptr<LobbyCache> lobbyCache_;
+    // Plays bots on boards other than the classic one, none: such games can't have a bot
+    std::shared_ptr<Mcts> mcts_;
 
     boost::uuids::string_generator uuidStrGen_;
 };
@@ -0,0 +1,100 @@
+#include "write_queue.h"
+
+#include <algorithm>
+#include <utility>
+
+WriteQueue::WriteQueue(WriteQueueLimits limits, std::shared_ptr<ServerStats> stats)
+    : limits_(limits)
+    , stats_(std::move(stats))
+    , bytes_(0)
+    , inFlight_(0)
+{}
+
+WriteQueue::~WriteQueue()
+{
+    stats_->queuedBytes.fetch_sub(bytes_, std::memory_order_relaxed);
+    stats_->queuedMessages.fetch_sub(entries_.size(), std::memory_order_relaxed);
+}
+
+bool WriteQueue::push(SharedBuffer message, MessageKind kind)
+{
+    bool lobby = kind == MessageKind::Lobby;
+    if (lobby && limits_.policy == SlowConsumerPolicy::MergeLobby && mergeLobby(message))
+        return true;
+
+    if (!fits(message->size())) {
+        if (limits_.policy == SlowConsumerPolicy::Close)
+            return false;
+        if (lobby) {
+            stats_->droppedMessages.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        evictLobby();
+        if (!fits(message->size()))
+            return false;
+    }
+
+    bytes_ += message->size();
+    stats_->queuedBytes.fetch_add(message->size(), std::memory_order_relaxed);
+    stats_->queuedMessages.fetch_add(1, std::memory_order_relaxed);
+    entries_.push_back({ std::move(message), kind });
+    return true;
+}
+
+void WriteQueue::startWrite(size_t count)
+{
+    inFlight_ = std::min(count, entries_.size());
+}
+
+void WriteQueue::finishWrite()
+{
+    erase(entries_.begin(), entries_.begin() + static_cast<std::ptrdiff_t>(inFlight_));
+    inFlight_ = 0;
+}
+
+bool WriteQueue::fits(size_t messageSize) const
+{
+    return entries_.size() < limits_.maxMessages && bytes_ + messageSize <= limits_.maxBytes;
+}
+
+// Replaces a lobby message that has not been handed to the socket yet. A replacement that would
+// not fit is dropped like any other lobby message, the queued one stays.
+bool WriteQueue::mergeLobby(SharedBuffer& message)
+{
+    auto it = std::find_if(entries_.begin() + static_cast<std::ptrdiff_t>(inFlight_), entries_.end(),
+                           [](const Entry& entry) { return entry.kind == MessageKind::Lobby; });
+    if (it == entries_.end())
+        return false;
+
+    if (bytes_ - it->data->size() + message->size() > limits_.maxBytes) {
+        stats_->droppedMessages.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    bytes_ = bytes_ - it->data->size() + message->size();
+    stats_->queuedBytes.fetch_add(message->size(), std::memory_order_relaxed);
+    stats_->queuedBytes.fetch_sub(it->data->size(), std::memory_order_relaxed);
+    stats_->mergedMessages.fetch_add(1, std::memory_order_relaxed);
+    it->data = std::move(message);
+    return true;
+}
+
+void WriteQueue::evictLobby()
+{
+    auto first = entries_.begin() + static_cast<std::ptrdiff_t>(inFlight_);
+    auto last = std::stable_partition(first, entries_.end(), [](const Entry& entry) { return entry.kind != MessageKind::Lobby; });
+    stats_->droppedMessages.fetch_add(static_cast<size_t>(entries_.end() - last), std::memory_order_relaxed);
+    erase(last, entries_.end());
+}
+
+void WriteQueue::erase(std::deque<Entry>::iterator begin, std::deque<Entry>::iterator end)
+{
+    size_t erasedBytes = 0;
+    for (auto it = begin; it != end; ++it)
+        erasedBytes += it->data->size();
+
+    bytes_ -= erasedBytes;
+    stats_->queuedBytes.fetch_sub(erasedBytes, std::memory_order_relaxed);
+    stats_->queuedMessages.fetch_sub(static_cast<size_t>(end - begin), std::memory_order_relaxed);
+    entries_.erase(begin, end);
+}
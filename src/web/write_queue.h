@@ -0,0 +1,73 @@
+#pragma once
+
+#include "common/out_message.h"
+#include "server_stats.h"
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+
+enum class MessageKind {
+    Critical, // game traffic and command replies, never dropped
+    Lobby,    // GAME_LIST, a newer one makes the older ones useless
+};
+
+enum class SlowConsumerPolicy {
+    // Lobby messages that do not fit are dropped, queued ones are evicted to make room for critical
+    // messages. The connection is closed only if critical messages alone overflow the queue.
+    DropLobby,
+    // Like DropLobby, but a new lobby message also replaces the one still waiting to be sent
+    MergeLobby,
+    // Any overflow closes the connection
+    Close,
+};
+
+struct WriteQueueLimits {
+    size_t maxBytes = 1 << 20;
+    size_t maxMessages = 1024;
+    SlowConsumerPolicy policy = SlowConsumerPolicy::MergeLobby;
+};
+
+// Outgoing messages of one session. Not thread safe, it lives on the session's strand.
+// The first inFlight() messages are being written and are not touched until finishWrite().
+class WriteQueue {
+public:
+    struct Entry {
+        SharedBuffer data;
+        MessageKind kind;
+    };
+
+    WriteQueue(WriteQueueLimits limits, std::shared_ptr<ServerStats> stats);
+    ~WriteQueue();
+
+    WriteQueue(const WriteQueue&) = delete;
+    WriteQueue& operator=(const WriteQueue&) = delete;
+
+    // Returns false if the message does not fit and the connection has to be closed
+    bool push(SharedBuffer message, MessageKind kind);
+
+    void startWrite(size_t count);
+    void finishWrite();
+
+    bool empty() const { return entries_.empty(); }
+    size_t size() const { return entries_.size(); }
+    size_t bytes() const { return bytes_; }
+    size_t inFlight() const { return inFlight_; }
+
+    const Entry& front() const { return entries_.front(); }
+    auto begin() const { return entries_.begin(); }
+    auto end() const { return entries_.end(); }
+
+private:
+    bool fits(size_t messageSize) const;
+    bool mergeLobby(SharedBuffer& message);
+    void evictLobby();
+    void erase(std::deque<Entry>::iterator begin, std::deque<Entry>::iterator end);
+
+    WriteQueueLimits limits_;
+    std::shared_ptr<ServerStats> stats_;
+
+    std::deque<Entry> entries_;
+    size_t bytes_;
+    size_t inFlight_;
+};
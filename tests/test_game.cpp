@@ -3,6 +3,22 @@
 
 #include "../src/game/player_manager.h"
 #include "../src/game/game_manager.h"
+#include "../src/game/epoch.h"
+#include "../src/game/game_pool.h"
+#include "../src/game/bot.h"
+#include "../src/game/solved_table.h"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/format.hpp>
+
+#include <chrono>
+#include <future>
+#include <thread>
+
+std::string moveInfo(const Notification& notification)
+{
+    return (boost::format("%d %d %c") % notification.x % notification.y % notification.mark).str();
+}
 
 struct GameTestFixture {
     GameTestFixture()
@@ -136,7 +152,7 @@ BOOST_FIXTURE_TEST_CASE(MakeMoveTest, GameTestFixture)
     BOOST_TEST_CHECK(notifications2.size(), 1);
     BOOST_CHECK(notifications2[0].type == Notification::Type::PlayerMoved);
     BOOST_CHECK(notifications2[0].playerNickname == player1->nickname());
-    BOOST_CHECK(notifications2[0].extraInfo == "0 0 X");
+    BOOST_CHECK(moveInfo(notifications2[0]) == "0 0 X");
 
     notifications1.clear();
     status = gameManager.makeMove(player2, 0, 1);
@@ -144,7 +160,7 @@ BOOST_FIXTURE_TEST_CASE(MakeMoveTest, GameTestFixture)
     BOOST_TEST_CHECK(notifications1.size(), 1);
     BOOST_CHECK(notifications1[0].type == Notification::Type::PlayerMoved);
     BOOST_CHECK(notifications1[0].playerNickname == player2->nickname());
-    BOOST_CHECK(notifications1[0].extraInfo == "0 1 O");
+    BOOST_CHECK(moveInfo(notifications1[0]) == "0 1 O");
 
     notifications2.clear();
     status = gameManager.makeMove(player1, 1, 0);
@@ -153,7 +169,7 @@ BOOST_FIXTURE_TEST_CASE(MakeMoveTest, GameTestFixture)
     BOOST_TEST_CHECK(notifications2.size(), 1);
     BOOST_CHECK(notifications2[0].type == Notification::Type::PlayerMoved);
     BOOST_CHECK(notifications2[0].playerNickname == player1->nickname());
-    BOOST_CHECK(notifications2[0].extraInfo == "1 0 X");
+    BOOST_CHECK(moveInfo(notifications2[0]) == "1 0 X");
 
     notifications1.clear();
     status = gameManager.makeMove(player2, 1, 1);
@@ -161,7 +177,7 @@ BOOST_FIXTURE_TEST_CASE(MakeMoveTest, GameTestFixture)
     BOOST_TEST_CHECK(notifications1.size(), 1);
     BOOST_CHECK(notifications1[0].type == Notification::Type::PlayerMoved);
     BOOST_CHECK(notifications1[0].playerNickname == player2->nickname());
-    BOOST_CHECK(notifications1[0].extraInfo == "1 1 O");
+    BOOST_CHECK(moveInfo(notifications1[0]) == "1 1 O");
 }
 
 BOOST_FIXTURE_TEST_CASE(NotTurnMakeMoveTest, GameTestFixture)
@@ -284,3 +300,603 @@ BOOST_FIXTURE_TEST_CASE(DrawGameTest, GameTestFixture)
     BOOST_CHECK(notifications2.back().type == Notification::Type::GameEnded);
     BOOST_CHECK(notifications2.back().playerNickname.empty());
 }
+
+BOOST_FIXTURE_TEST_CASE(GomokuWinGameTest, GameTestFixture)
+{
+    auto gameId = gameManager.createGame(BoardRules{ .size = 15, .winLength = 5 });
+    gameManager.addPlayerToGame(player1, gameId);
+    gameManager.addPlayerToGame(player2, gameId);
+
+    BOOST_TEST(!gameManager.makeMove(player1, 15, 0));
+
+    // X fills a diagonal from both ends, the last move lands in the middle
+    bool status = true;
+    for (auto [x, y, ox, oy] : std::vector<std::array<int, 4>>{ {10, 10, 0, 0}, {11, 11, 0, 1}, {13, 13, 0, 2}, {14, 14, 0, 3} }) {
+        status = status && gameManager.makeMove(player1, x, y);
+        status = status && gameManager.makeMove(player2, ox, oy);
+    }
+    BOOST_TEST(status);
+    BOOST_CHECK(notifications1.back().type != Notification::Type::GameEnded);
+
+    status = gameManager.makeMove(player1, 12, 12);
+    BOOST_TEST(status);
+    BOOST_CHECK(notifications1.back().type == Notification::Type::GameEnded);
+    BOOST_CHECK(notifications1.back().playerNickname == player1->nickname());
+}
+
+BOOST_FIXTURE_TEST_CASE(ShardedRegistryTest, GameTestFixture)
+{
+    GameManager manager(false, 4);
+    BOOST_CHECK_EQUAL(manager.shardCount(), 4u);
+
+    std::vector<Id> gameIds;
+    for (int i = 0; i < 10; ++i)
+        gameIds.push_back(manager.createGame());
+    BOOST_CHECK_EQUAL(manager.lobbyVersion(), 0u);
+    manager.addPlayerToGame(player1, gameIds[5]);
+    manager.addPlayerToGame(player2, gameIds[6]);
+    BOOST_CHECK_EQUAL(manager.getWaitingGames().size(), 2u);
+    BOOST_CHECK_EQUAL(manager.lobbyVersion(), 2u);
+
+    // Pages are merged from every shard in id order
+    auto third = playerManager.createPlayer("p3");
+    manager.addPlayerToGame(third, gameIds[1]);
+    auto page = manager.getWaitingGames(2);
+    BOOST_REQUIRE_EQUAL(page.size(), 2u);
+    BOOST_CHECK_EQUAL(page[0]->id(), gameIds[1]);
+    BOOST_CHECK_EQUAL(page[1]->id(), gameIds[5]);
+    page = manager.getWaitingGames(2, page.back()->id());
+    BOOST_REQUIRE_EQUAL(page.size(), 1u);
+    BOOST_CHECK_EQUAL(page[0]->id(), gameIds[6]);
+
+    // A full game leaves the index
+    auto fourth = playerManager.createPlayer("p4");
+    manager.addPlayerToGame(fourth, gameIds[6]);
+    BOOST_CHECK_EQUAL(manager.getWaitingGames().size(), 2u);
+    BOOST_CHECK_EQUAL(manager.lobbyVersion(), 4u);
+
+    for (auto gameId : gameIds) {
+        BOOST_REQUIRE(manager.getGame(gameId));
+        manager.removeGame(gameId);
+        BOOST_CHECK(!manager.getGame(gameId));
+    }
+    BOOST_CHECK(manager.getWaitingGames().empty());
+    third->leaveGame();
+    fourth->leaveGame();
+}
+
+BOOST_FIXTURE_TEST_CASE(QuickMatchTest, GameTestFixture)
+{
+    auto queued = gameManager.quickMatch(player1);
+    BOOST_REQUIRE(queued);
+    auto ticket = std::get<std::shared_ptr<MatchTicket>>(*queued);
+    BOOST_CHECK(ticket->isWaiting());
+    BOOST_CHECK(!player1->isInGame());
+
+    // The waiting player takes the first seat, the game never shows up in the lobby
+    auto lobbyVersion = gameManager.lobbyVersion();
+    auto matched = gameManager.quickMatch(player2);
+    BOOST_REQUIRE(matched && std::holds_alternative<Id>(*matched));
+    auto game = gameManager.getGame(std::get<Id>(*matched));
+    BOOST_REQUIRE(game);
+    BOOST_CHECK(game->player1() == player1);
+    BOOST_CHECK(game->player2() == player2);
+    BOOST_CHECK(notifications1.back().type == Notification::Type::PlayerJoined);
+    BOOST_CHECK_EQUAL(gameManager.lobbyVersion(), lobbyVersion);
+    BOOST_CHECK(!ticket->isWaiting());
+    BOOST_CHECK(ticket->cancel());
+    BOOST_CHECK(!gameManager.quickMatch(player1));
+    BOOST_TEST(gameManager.makeMove(player1, 0, 0));
+    gameManager.leavePlayerFromGame(player1);
+
+    // A cancelled ticket is skipped
+    auto player3 = playerManager.createPlayer("p3");
+    auto player4 = playerManager.createPlayer("p4");
+    BOOST_CHECK(std::get<std::shared_ptr<MatchTicket>>(*gameManager.quickMatch(player3))->cancel());
+    auto next = gameManager.quickMatch(player4);
+    BOOST_REQUIRE(next);
+    BOOST_CHECK(std::holds_alternative<std::shared_ptr<MatchTicket>>(*next));
+    BOOST_CHECK(!player3->isInGame());
+}
+
+BOOST_AUTO_TEST_CASE(ConcurrentQuickMatchTest)
+{
+    constexpr int THREADS = 8;
+    constexpr int PLAYERS_PER_THREAD = 200;
+
+    PlayerManager playerManager;
+    GameManager manager(false, 16);
+    std::vector<std::shared_ptr<Player>> players;
+    for (int i = 0; i < THREADS * PLAYERS_PER_THREAD; ++i)
+        players.push_back(playerManager.createPlayer("p" + std::to_string(i)));
+
+    std::vector<std::thread> threads;
+    std::vector<std::vector<Id>> gameIds(THREADS);
+    std::atomic<int> queued = 0;
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&, t]() {
+            for (int i = t * PLAYERS_PER_THREAD; i < (t + 1) * PLAYERS_PER_THREAD; ++i) {
+                auto match = manager.quickMatch(players[i]);
+                if (match && std::holds_alternative<Id>(*match))
+                    gameIds[t].push_back(std::get<Id>(*match));
+                else if (match)
+                    ++queued;
+            }
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+
+    // Every call either queued the player or paired it, and every paired player sits in exactly one full game
+    size_t games = 0;
+    int paired = 0;
+    for (const auto& ids : gameIds) {
+        for (auto gameId : ids) {
+            auto game = manager.getGame(gameId);
+            BOOST_REQUIRE(game && game->player1() && game->player2());
+            BOOST_CHECK(game->player1() != game->player2());
+            BOOST_CHECK_EQUAL(*game->player1()->curGameId(), gameId);
+            BOOST_CHECK_EQUAL(*game->player2()->curGameId(), gameId);
+            ++games;
+        }
+    }
+    for (const auto& player : players)
+        paired += player->isInGame();
+    BOOST_CHECK_EQUAL(paired, 2 * games);
+    BOOST_CHECK_EQUAL(games + queued.load(), THREADS * PLAYERS_PER_THREAD);
+    // Players queued at the same time find each other, only the odd one out is left waiting
+    BOOST_CHECK_LE(players.size() - paired, 1u);
+    BOOST_CHECK(manager.getWaitingGames().empty());
+}
+
+BOOST_FIXTURE_TEST_CASE(RatingTest, GameTestFixture)
+{
+    auto winByPlayer1 = [this]()
+        {
+            for (auto [x, y] : std::vector<std::pair<int, int>>{ {0, 0}, {1, 0}, {0, 1}, {1, 1}, {0, 2} })
+                gameManager.makeMove(x == 0 ? player1 : player2, x, y);
+        };
+    // Paired by rated matchmaking, the one that waited moves first
+    auto ratedGame = [this]()
+        {
+            gameManager.ratedMatch(player1);
+            auto match = gameManager.ratedMatch(player2);
+            BOOST_REQUIRE(match && std::holds_alternative<Id>(*match));
+            BOOST_REQUIRE(gameManager.getGame(std::get<Id>(*match))->isRated());
+        };
+
+    // Only rated matchmaking games count
+    auto gameId = gameManager.createGame();
+    gameManager.addPlayerToGame(player1, gameId);
+    gameManager.addPlayerToGame(player2, gameId);
+    winByPlayer1();
+    BOOST_CHECK_EQUAL(player1->rating(), INITIAL_RATING);
+    BOOST_CHECK_EQUAL(player2->rating(), INITIAL_RATING);
+
+    ratedGame();
+    winByPlayer1();
+    BOOST_CHECK_CLOSE(player1->rating(), INITIAL_RATING + RATING_K_FACTOR / 2, 1e-9);
+    BOOST_CHECK_CLOSE(player2->rating(), INITIAL_RATING - RATING_K_FACTOR / 2, 1e-9);
+
+    // Leaving loses the game, the favourite gains less than it would lose
+    ratedGame();
+    gameManager.leavePlayerFromGame(player2);
+    BOOST_CHECK_GT(player1->rating() - INITIAL_RATING, RATING_K_FACTOR / 2);
+    BOOST_CHECK_LT(player1->rating() - INITIAL_RATING, RATING_K_FACTOR);
+    BOOST_CHECK_CLOSE(player1->rating() + player2->rating(), 2 * INITIAL_RATING, 1e-9);
+
+    // Never against a bot, even in a rated game
+    auto bot = playerManager.createPlayer("bot", true);
+    auto rating = player1->rating();
+    Game game(0, BoardRules{}, false, nullptr, true);
+    game.join(player1);
+    game.join(bot);
+    game.leave(bot);
+    BOOST_CHECK_EQUAL(player1->rating(), rating);
+    BOOST_CHECK_EQUAL(bot->rating(), INITIAL_RATING);
+}
+
+BOOST_FIXTURE_TEST_CASE(RatedMatchTest, GameTestFixture)
+{
+    using namespace std::chrono_literals;
+    GameManager manager(false, 4, 16, RatingWindow{ .initial = 100, .widenPerSecond = 50, .max = 300 });
+    auto now = RatingPool::Clock::now();
+    auto player3 = playerManager.createPlayer("p3");
+    auto player4 = playerManager.createPlayer("p4");
+    player1->setRating(1500);
+    player2->setRating(1720);
+    player3->setRating(1560);
+    player4->setRating(1100);
+
+    BOOST_CHECK(std::holds_alternative<std::shared_ptr<MatchTicket>>(*manager.ratedMatch(player1, now)));
+    BOOST_CHECK(std::holds_alternative<std::shared_ptr<MatchTicket>>(*manager.ratedMatch(player2, now)));
+    BOOST_CHECK(std::holds_alternative<std::shared_ptr<MatchTicket>>(*manager.ratedMatch(player4, now)));
+    BOOST_CHECK(manager.matchRatedPlayers(now + 1s).empty());
+
+    // Within 100 of p1, and closer to it than to p2
+    auto match = manager.ratedMatch(player3, now + 1s);
+    BOOST_REQUIRE(match && std::holds_alternative<Id>(*match));
+    auto game = manager.getGame(std::get<Id>(*match));
+    BOOST_CHECK(game->player1() == player1);
+    BOOST_CHECK(game->player2() == player3);
+    manager.leavePlayerFromGame(player3);
+
+    // p1 comes back. The 220 to p2 is in p2's window after 3 s, the 400 to p4 never is.
+    BOOST_CHECK(std::holds_alternative<std::shared_ptr<MatchTicket>>(*manager.ratedMatch(player1, now + 1s)));
+    BOOST_CHECK(manager.matchRatedPlayers(now + 2s).empty());
+    notifications1.clear();
+    notifications2.clear();
+    auto gameIds = manager.matchRatedPlayers(now + 3s);
+    BOOST_REQUIRE_EQUAL(gameIds.size(), 1u);
+    game = manager.getGame(gameIds[0]);
+    BOOST_CHECK(game->player1() == player2);
+    BOOST_CHECK(game->player2() == player1);
+    // Neither asked for the game just now, both are told
+    BOOST_REQUIRE_EQUAL(notifications1.size(), 1u);
+    BOOST_CHECK(notifications1[0].type == Notification::Type::MatchFound);
+    BOOST_CHECK_EQUAL(notifications1[0].gameId, gameIds[0]);
+    BOOST_CHECK_EQUAL(notifications1[0].playerNickname, player2->nickname());
+    BOOST_REQUIRE_EQUAL(notifications2.size(), 1u);
+    BOOST_CHECK(notifications2[0].type == Notification::Type::PlayerJoined);
+    BOOST_CHECK(manager.matchRatedPlayers(now + 60s).empty());
+    BOOST_CHECK(!player4->isInGame());
+    manager.leavePlayerFromGame(player1);
+}
+
+BOOST_AUTO_TEST_CASE(GameSlabTest)
+{
+    GameSlab slab(1, 4);
+    auto first = slab.reserve();
+    auto second = slab.reserve();
+    BOOST_CHECK_EQUAL(first, 1u);
+    BOOST_CHECK_EQUAL(second, 5u);
+    BOOST_CHECK_EQUAL(GameSlab::shardOf(second, 4), 1u);
+
+    // A reserved slot has no game yet
+    BOOST_CHECK(!slab.get(first));
+    slab.set(first, std::make_shared<Game>(first));
+    slab.set(second, std::make_shared<Game>(second));
+    BOOST_REQUIRE(slab.get(first));
+    BOOST_CHECK_EQUAL(slab.get(first)->id(), first);
+    BOOST_CHECK_EQUAL(slab.size(), 2u);
+
+    // The freed slot comes back under a new generation, its old handle stays dead
+    BOOST_CHECK(slab.release(first));
+    BOOST_CHECK(!slab.get(first));
+    BOOST_CHECK(!slab.release(first));
+    auto reused = slab.reserve();
+    BOOST_CHECK_EQUAL(reused & GameSlab::INDEX_MASK, first);
+    BOOST_CHECK_NE(reused, first);
+    slab.set(reused, std::make_shared<Game>(reused));
+    BOOST_CHECK(!slab.get(first));
+    BOOST_CHECK(slab.get(reused));
+
+    // Handles of other shards and never used slots are rejected
+    BOOST_CHECK(!slab.get(2));
+    BOOST_CHECK(!slab.get(9));
+    BOOST_CHECK(!slab.get(GameSlab::INVALID_HANDLE));
+}
+
+BOOST_FIXTURE_TEST_CASE(StaleGameIdTest, GameTestFixture)
+{
+    GameManager manager(false, 1);
+    auto gameId = manager.createGame();
+    manager.addPlayerToGame(player1, gameId);
+    manager.leavePlayerFromGame(player1);
+
+    auto nextId = manager.createGame();
+    BOOST_CHECK_NE(nextId, gameId);
+    BOOST_CHECK(!manager.getGame(gameId));
+    BOOST_CHECK(!manager.addPlayerToGame(player1, gameId));
+    manager.removeGame(gameId);
+    BOOST_CHECK(manager.getGame(nextId));
+}
+
+BOOST_FIXTURE_TEST_CASE(EpochReadsTest, GameTestFixture)
+{
+    GameManager manager(false, 4, GameManager::DEFAULT_MATCH_QUEUE_CAPACITY, RatingWindow{}, true);
+    auto gameId = manager.createGame();
+    BOOST_TEST(manager.addPlayerToGame(player1, gameId));
+    BOOST_TEST(manager.addPlayerToGame(player2, gameId));
+
+    auto game = manager.getGame(gameId);
+    BOOST_REQUIRE(game);
+    BOOST_TEST(manager.makeMove(player1, 0, 0));
+    BOOST_TEST(manager.makeMove(player2, 0, 1));
+    BOOST_TEST(manager.makeMove(player1, 1, 0));
+    BOOST_TEST(manager.makeMove(player2, 1, 1));
+    BOOST_TEST(manager.makeMove(player1, 2, 0));
+    BOOST_TEST(game->isOver());
+    BOOST_CHECK(!manager.getGame(gameId));
+    BOOST_TEST(!manager.makeMove(player2, 2, 1));
+
+    // The slot is reused, the handle of the game that was there is not
+    auto nextId = manager.createGame();
+    for (int i = 0; i < 4 && GameSlab::shardOf(nextId, 4) != GameSlab::shardOf(gameId, 4); ++i)
+        nextId = manager.createGame();
+    BOOST_CHECK_EQUAL(nextId & GameSlab::INDEX_MASK, gameId & GameSlab::INDEX_MASK);
+    BOOST_CHECK(manager.getGame(nextId));
+    BOOST_CHECK(!manager.getGame(gameId));
+
+    // Retiring never frees anything, the reaper does once no reader can see it
+    auto& domain = EpochDomain::instance();
+    BOOST_CHECK_GT(domain.pending(), 0u);
+    for (int i = 0; i < 3; ++i)
+        manager.reapGames(0, std::chrono::hours(1));
+    BOOST_CHECK_EQUAL(domain.pending(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(EpochDomainTest)
+{
+    struct Tracked {
+        ~Tracked() { deleted->store(true); }
+        std::atomic_bool* deleted;
+    };
+
+    auto& domain = EpochDomain::instance();
+    std::atomic_bool deleted{ false };
+    {
+        auto pin = domain.pin();
+        domain.retire(new Tracked{ &deleted });
+        // A pinned reader holds the object however often the epoch is tried
+        std::thread([&domain]() { for (int i = 0; i < 4; ++i) domain.collect(); }).join();
+        BOOST_TEST(!deleted);
+    }
+    for (int i = 0; i < 4 && !deleted; ++i)
+        domain.collect();
+    BOOST_TEST(deleted);
+}
+
+BOOST_AUTO_TEST_CASE(GamePoolTest)
+{
+    auto pool = std::make_shared<GamePool>(1);
+    auto first = std::allocate_shared<Game>(GamePoolAllocator<Game>(pool), 1);
+    const Game* address = first.get();
+    first.reset();
+    // The next game moves into the memory of the last one
+    auto second = std::allocate_shared<Game>(GamePoolAllocator<Game>(pool), 2);
+    BOOST_TEST(second.get() == address);
+    // With the pool empty the third one comes from the heap, and one of them doesn't fit back in
+    auto third = std::allocate_shared<Game>(GamePoolAllocator<Game>(pool), 3);
+    BOOST_TEST(third.get() != address);
+    // The games hold on to the pool
+    pool.reset();
+    second.reset();
+    third.reset();
+}
+
+BOOST_FIXTURE_TEST_CASE(ReapGamesTest, GameTestFixture)
+{
+    using namespace std::chrono_literals;
+
+    GameManager manager(false, 4);
+    auto emptyId = manager.createGame();
+    auto waitingId = manager.createGame();
+    auto overId = manager.createGame();
+    BOOST_TEST(manager.addPlayerToGame(player1, waitingId));
+    // Left behind the manager's back, so the game stays registered
+    BOOST_TEST(manager.addPlayerToGame(player2, overId));
+    BOOST_TEST(manager.getGame(overId)->leave(player2));
+
+    auto reaped = manager.reapGames(SIZE_MAX, 1h);
+    BOOST_TEST(reaped.over == 1);
+    BOOST_TEST(reaped.empty == 0);
+    BOOST_TEST(reaped.visited == 3);
+    BOOST_CHECK(!manager.getGame(overId));
+    BOOST_CHECK(manager.getGame(emptyId));
+
+    auto emptyGame = manager.getGame(emptyId);
+    reaped = manager.reapGames(SIZE_MAX, 0s);
+    BOOST_TEST(reaped.empty == 1);
+    BOOST_CHECK(!manager.getGame(emptyId));
+    BOOST_TEST(!emptyGame->join(player2));
+    BOOST_TEST(manager.getWaitingGames().size() == 1);
+    BOOST_CHECK(manager.getGame(waitingId));
+}
+
+BOOST_AUTO_TEST_CASE(ReapGamesBudgetTest)
+{
+    using namespace std::chrono_literals;
+
+    GameManager manager(false, 2);
+    for (int i = 0; i < 300; ++i)
+        manager.createGame();
+
+    size_t empty = 0;
+    size_t calls = 0;
+    for (; empty < 300 && calls < 100; ++calls) {
+        auto reaped = manager.reapGames(50, 0s);
+        BOOST_TEST(reaped.visited <= 50);
+        empty += reaped.empty;
+    }
+    BOOST_TEST(empty == 300);
+    BOOST_TEST(calls == 6);
+}
+
+BOOST_AUTO_TEST_CASE(BoardRulesTest)
+{
+    BOOST_TEST(BoardRules{}.isValid());
+    BOOST_TEST((BoardRules{ .size = 16, .winLength = 16 }.isValid()));
+    BOOST_TEST(!(BoardRules{ .size = 17, .winLength = 5 }.isValid()));
+    BOOST_TEST(!(BoardRules{ .size = 4, .winLength = 5 }.isValid()));
+
+    GridBoard board(BoardRules{ .size = 4, .winLength = 4 });
+    BOOST_TEST(!board.place(1, 0, 3));
+    BOOST_TEST(!board.place(1, 1, 2));
+    BOOST_TEST(!board.place(0, 2, 1));
+    BOOST_TEST(!board.place(1, 3, 0));
+    BOOST_TEST(!board.isFree(3, 0));
+    BOOST_TEST(!board.isFree(4, 0));
+}
+
+struct LockFreeGameTestFixture : GameTestFixture {
+    LockFreeGameTestFixture()
+        : lockFreeGameManager(true)
+    {}
+
+    GameManager lockFreeGameManager;
+};
+
+BOOST_FIXTURE_TEST_CASE(LockFreeWinGameTest, LockFreeGameTestFixture)
+{
+    auto gameId = lockFreeGameManager.createGame();
+    BOOST_TEST(!lockFreeGameManager.makeMove(player1, 0, 0)); // not joined
+    lockFreeGameManager.addPlayerToGame(player1, gameId);
+    BOOST_TEST(!lockFreeGameManager.makeMove(player1, 0, 0)); // opponent has not joined yet
+    lockFreeGameManager.addPlayerToGame(player2, gameId);
+    notifications1.clear();
+
+    BOOST_TEST(!lockFreeGameManager.makeMove(player2, 0, 0)); // not his turn
+    BOOST_TEST(lockFreeGameManager.makeMove(player1, 0, 0));
+    BOOST_TEST(!lockFreeGameManager.makeMove(player2, 0, 0)); // taken
+    BOOST_TEST(!lockFreeGameManager.makeMove(player2, 3, 0));
+    BOOST_TEST(lockFreeGameManager.makeMove(player2, 1, 0));
+    BOOST_TEST(lockFreeGameManager.makeMove(player1, 0, 1));
+    BOOST_TEST(lockFreeGameManager.makeMove(player2, 1, 1));
+    BOOST_TEST(lockFreeGameManager.makeMove(player1, 0, 2));
+
+    BOOST_CHECK_EQUAL(moveInfo(notifications2[0]), "0 0 X");
+    BOOST_CHECK_EQUAL(moveInfo(notifications1[1]), "1 0 O");
+    BOOST_CHECK(notifications2.back().type == Notification::Type::GameEnded);
+    BOOST_CHECK(notifications2.back().playerNickname == player1->nickname());
+    BOOST_TEST(!player1->isInGame());
+    BOOST_TEST(!lockFreeGameManager.getGame(gameId));
+}
+
+BOOST_FIXTURE_TEST_CASE(LockFreeConcurrentMoveTest, LockFreeGameTestFixture)
+{
+    // Threads race to make the same player's move, exactly one of them may land on every turn
+    for (int round = 0; round < 100; ++round) {
+        Game game(0, BoardRules{}, true);
+        game.join(player1);
+        game.join(player2);
+
+        std::atomic<int> applied = 0;
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 4; ++i) {
+            threads.emplace_back([&game, &applied, i, this]() {
+                applied += game.makeMove(player1->id(), i % 3, i / 3);
+            });
+        }
+        for (auto& thread : threads)
+            thread.join();
+        BOOST_CHECK_EQUAL(applied.load(), 1);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(LockFreeNotificationOrderTest, LockFreeGameTestFixture)
+{
+    // O moves as soon as X's move is committed, while X's notifications are still on their way
+    std::mutex mutex;
+    std::vector<std::string> seen;
+    std::promise<void> committed;
+    player1->setNotificationHandler([&](const Notification& notification)
+        {
+            if (notification.type != Notification::Type::PlayerMoved)
+                return;
+            if (notification.mark == 'X') {
+                committed.set_value();
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            }
+            std::lock_guard lock(mutex);
+            seen.push_back(moveInfo(notification));
+        });
+    Game game(0, BoardRules{}, true);
+    game.join(player1);
+    game.join(player2);
+
+    std::thread mover([&game, this]() { game.makeMove(player1->id(), 0, 0); });
+    committed.get_future().wait();
+    BOOST_TEST(game.makeMove(player2->id(), 1, 1));
+    mover.join();
+
+    BOOST_REQUIRE_EQUAL(seen.size(), 2u);
+    BOOST_CHECK_EQUAL(seen[0], "0 0 X");
+    BOOST_CHECK_EQUAL(seen[1], "1 1 O");
+}
+
+// Whatever X plays, the table never lets O lose
+int worstOutcomeForO(std::array<int, 9>& cells, int position, int side)
+{
+    static constexpr std::array<std::array<int, 3>, 8> lines = {{
+        {0, 1, 2}, {3, 4, 5}, {6, 7, 8}, {0, 3, 6}, {1, 4, 7}, {2, 5, 8}, {0, 4, 8}, {2, 4, 6},
+    }};
+    for (const auto& line : lines) {
+        if (cells[line[0]] && cells[line[0]] == cells[line[1]] && cells[line[0]] == cells[line[2]])
+            return cells[line[0]] == 2 ? 1 : -1;
+    }
+
+    int worst = 1;
+    bool moved = false;
+    for (int cell = 0; cell < 9; ++cell) {
+        if (cells[cell] || (side == 1 && cell != SolvedTable::bestMove(position)))
+            continue;
+        moved = true;
+        cells[cell] = side + 1;
+        worst = std::min(worst, worstOutcomeForO(cells, SolvedTable::withMove(position, side, cell), 1 - side));
+        cells[cell] = 0;
+    }
+    return moved ? worst : 0;
+}
+
+BOOST_AUTO_TEST_CASE(SolvedTableTest)
+{
+    BOOST_CHECK_EQUAL(SolvedTable::value(0), 0);
+    BOOST_CHECK_EQUAL(SolvedTable::bestMove(SolvedTable::withMove(0, 0, 0)), 4); // corner is answered in the center
+
+    std::array<int, 9> cells{};
+    BOOST_CHECK_EQUAL(worstOutcomeForO(cells, 0, 0), 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(BotGameTest, GameTestFixture)
+{
+    boost::asio::io_context ioc;
+    auto manager = std::make_shared<GameManager>();
+
+    auto gameId = manager->createGame();
+    manager->addPlayerToGame(player1, gameId);
+    manager->addPlayerToGame(Bot::createPerfect(playerManager, manager, ioc.get_executor()), gameId);
+    BOOST_CHECK(notifications1.back().type == Notification::Type::PlayerJoined);
+
+    // X always takes the first free cell, which loses to perfect play
+    std::array<bool, 9> taken{};
+    while (manager->getGame(gameId)) {
+        int cell = 0;
+        while (taken[cell])
+            ++cell;
+        BOOST_REQUIRE(manager->makeMove(player1, cell / 3, cell % 3));
+        ioc.restart();
+        ioc.run();
+        for (const auto& notification : notifications1) {
+            if (notification.type == Notification::Type::PlayerMoved)
+                taken[notification.x * 3 + notification.y] = true;
+        }
+    }
+
+    BOOST_CHECK(notifications1.back().type == Notification::Type::GameEnded);
+    BOOST_CHECK_EQUAL(notifications1.back().playerNickname, "bot");
+    BOOST_TEST(!player1->isInGame());
+    BOOST_CHECK_EQUAL(player1->rating(), INITIAL_RATING);
+}
+
+BOOST_AUTO_TEST_CASE(MctsWinningMoveTest)
+{
+    Mcts mcts(2, MctsOptions{ .moveBudget = std::chrono::milliseconds(100) });
+    auto search = mcts.makeSearch();
+
+    // O has four in a column with an open end, X has four in a row but it is O's move
+    auto board = makeBoard(BoardRules{ .size = 15, .winLength = 5 });
+    for (int i = 0; i < 4; ++i) {
+        board->place(0, 10, 3 + i);
+        board->place(1, 2 + i, 1);
+    }
+
+    for (int move = 0; move < 2; ++move) {
+        std::promise<MctsResult> promise;
+        mcts.search(search, *board, 1, [&promise](const MctsResult& result) { promise.set_value(result); });
+        auto result = promise.get_future().get();
+        BOOST_CHECK_GT(result.playouts, 0u);
+        BOOST_CHECK(result.x == 6 || result.x == 1);
+        BOOST_CHECK_EQUAL(result.y, 1);
+    }
+}
@@ -4,7 +4,12 @@
 
 #include "../src/web/server.h"
 #include "../src/web/common/command_code.h"
+#include "../src/web/common/handshake.h"
 #include "../src/web/common/tools.h"
+#include "../src/web/lobby_cache.h"
+#include "../src/web/write_queue.h"
+
+#include <deque>
 
 using tcp = boost::asio::ip::tcp;
 namespace websocket = boost::beast::websocket;
@@ -14,11 +19,12 @@ struct TestClient {
         : resolver_(ioc), ws_(ioc)
     {}
 
-    void connect()
+    void connect(const std::string& target = "/", const std::string& port = "8080")
     {
-        auto const results = resolver_.resolve("localhost", "8080");
+        auto const results = resolver_.resolve("localhost", port);
         boost::asio::connect(ws_.next_layer(), results);
-        ws_.handshake("localhost", "/");
+        ws_.handshake("localhost", target);
+        options_ = parseHandshakeOptions(target);
     }
 
     void disconnect()
@@ -36,18 +42,36 @@ struct TestClient {
         ws_.write(boost::asio::buffer(message));
     }
 
+    void sendBinaryMessage(const std::string& message)
+    {
+        ws_.binary(true);
+        ws_.write(boost::asio::buffer(message));
+    }
+
     Message receiveMessage()
     {
-        boost::beast::flat_buffer buffer;
-        ws_.read(buffer);
-        auto data = boost::beast::buffers_to_string(buffer.data());
-        
-        return getInMessage(data);
+        if (pending_.empty()) {
+            boost::beast::flat_buffer buffer;
+            ws_.read(buffer);
+            auto data = boost::beast::buffers_to_string(buffer.data());
+            if (options_.batch) {
+                auto messages = splitBatchedFrame(data, options_.encoding);
+                pending_.insert(pending_.end(), messages.begin(), messages.end());
+            } else {
+                pending_.push_back(data);
+            }
+        }
+
+        auto data = pending_.front();
+        pending_.pop_front();
+        return options_.encoding == Encoding::Binary ? getInBinaryMessage(data) : getInMessage(data);
     }
 
 private:
     tcp::resolver resolver_;
     websocket::stream<tcp::socket> ws_;
+    std::deque<std::string> pending_;
+    HandshakeOptions options_;
 };
 
 struct WsTestGlobalFixture {
@@ -118,6 +142,28 @@ BOOST_FIXTURE_TEST_CASE(AuthTest, WsTestFixture)
     BOOST_CHECK_EQUAL(message.code, OutCommandCode::PLAYER_AUTHED);
 }
 
+BOOST_FIXTURE_TEST_CASE(AuthSeparatorNicknameTest, WsTestFixture)
+{
+    client1.connect();
+    client1.sendMessage(InCommandCode::AUTH, "a|b");
+    BOOST_CHECK_EQUAL(*client1.receiveMessage().errorCode, ErrorCode::INCORRECT_FORMAT);
+    client1.sendMessage(InCommandCode::AUTH, "a\nb");
+    BOOST_CHECK_EQUAL(*client1.receiveMessage().errorCode, ErrorCode::INCORRECT_FORMAT);
+
+    // A binary nickname is length-prefixed, but text clients get it too
+    client2.connect("/?encoding=binary");
+    for (const auto& nickname : std::vector<std::string>{ "a b", "a|b", "a\nb", std::string("a\0b", 3), "" }) {
+        auto auth = std::string(1, static_cast<char>(InCommandCode::AUTH));
+        writeString(auth, nickname);
+        client2.sendBinaryMessage(auth);
+        BOOST_CHECK_EQUAL(*client2.receiveMessage().errorCode, ErrorCode::INCORRECT_FORMAT);
+    }
+    auto auth = std::string(1, static_cast<char>(InCommandCode::AUTH));
+    writeString(auth, nickname2);
+    client2.sendBinaryMessage(auth);
+    BOOST_CHECK_EQUAL(client2.receiveMessage().code, OutCommandCode::PLAYER_AUTHED);
+}
+
 BOOST_FIXTURE_TEST_CASE(JoinGameTest, WsTestFixture)
 {
     connectClients();
@@ -137,6 +183,176 @@ BOOST_FIXTURE_TEST_CASE(JoinGameTest, WsTestFixture)
     BOOST_CHECK_EQUAL(message.message, nickname2);
 }
 
+BOOST_FIXTURE_TEST_CASE(QuickMatchTest, WsTestFixture)
+{
+    connectClients();
+
+    client1.sendMessage(InCommandCode::QUICK_MATCH);
+    BOOST_CHECK_EQUAL(client1.receiveMessage().code, OutCommandCode::MATCH_QUEUED);
+    client1.sendMessage(InCommandCode::QUICK_MATCH);
+    BOOST_CHECK_EQUAL(*client1.receiveMessage().errorCode, ErrorCode::ERROR_JOIN);
+
+    client2.sendMessage(InCommandCode::QUICK_MATCH);
+    auto message = client2.receiveMessage();
+    BOOST_CHECK_EQUAL(message.code, OutCommandCode::JOINED_GAME);
+    BOOST_CHECK(message.message.ends_with(' ' + nickname1));
+
+    message = client1.receiveMessage();
+    BOOST_CHECK_EQUAL(message.code, OutCommandCode::OPPONENT_JOINED);
+    BOOST_CHECK_EQUAL(message.message, nickname2);
+
+    client1.sendMessage(InCommandCode::MOVE, "1 1");
+    BOOST_CHECK_EQUAL(client1.receiveMessage().code, OutCommandCode::MOVED);
+    BOOST_CHECK_EQUAL(client2.receiveMessage().code, OutCommandCode::MOVED);
+    client1.sendMessage(InCommandCode::LEAVE_GAME);
+    BOOST_CHECK_EQUAL(client1.receiveMessage().code, OutCommandCode::LEFT_GAME);
+    BOOST_CHECK_EQUAL(client2.receiveMessage().code, OutCommandCode::GAME_ENDED);
+
+    // Leaving the queue before being paired
+    client1.sendMessage(InCommandCode::QUICK_MATCH);
+    BOOST_CHECK_EQUAL(client1.receiveMessage().code, OutCommandCode::MATCH_QUEUED);
+    client1.sendMessage(InCommandCode::LEAVE_GAME);
+    BOOST_CHECK_EQUAL(client1.receiveMessage().code, OutCommandCode::LEFT_GAME);
+    client2.sendMessage(InCommandCode::QUICK_MATCH);
+    BOOST_CHECK_EQUAL(client2.receiveMessage().code, OutCommandCode::MATCH_QUEUED);
+    client2.sendMessage(InCommandCode::LEAVE_GAME);
+    client2.receiveMessage();
+}
+
+// Players too far apart to be paired right away are paired by the server's matching timer
+BOOST_FIXTURE_TEST_CASE(RatedMatchTimerTest, WsTestFixture)
+{
+    ServerOptions options;
+    options.ratedMatchInterval = std::chrono::milliseconds(50);
+    // Nobody is within reach on arrival, everybody is once waiting for 0.1 s
+    options.ratingWindow = RatingWindow{ .initial = -1, .widenPerSecond = 10 };
+    Server server(1, 8081, options);
+    std::thread serverThread([&server]() { server.start(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+    client1.connect("/", "8081");
+    client1.sendMessage(InCommandCode::AUTH, nickname1);
+    client1.receiveMessage();
+    client2.connect("/", "8081");
+    client2.sendMessage(InCommandCode::AUTH, nickname2);
+    client2.receiveMessage();
+
+    client1.sendMessage(InCommandCode::QUICK_MATCH, "1");
+    BOOST_CHECK_EQUAL(client1.receiveMessage().code, OutCommandCode::MATCH_QUEUED);
+    client2.sendMessage(InCommandCode::QUICK_MATCH, "1");
+    BOOST_CHECK_EQUAL(client2.receiveMessage().code, OutCommandCode::MATCH_QUEUED);
+
+    // The one that waited longer moves first, the other one learns its game without a move
+    auto message = client1.receiveMessage();
+    BOOST_CHECK_EQUAL(message.code, OutCommandCode::OPPONENT_JOINED);
+    BOOST_CHECK_EQUAL(message.message, nickname2);
+    message = client2.receiveMessage();
+    BOOST_CHECK_EQUAL(message.code, OutCommandCode::JOINED_GAME);
+    auto pos = message.message.find(' ');
+    BOOST_CHECK_EQUAL(message.message.substr(pos + 1), nickname1);
+
+    client1.sendMessage(InCommandCode::MOVE, "1 1");
+    client1.receiveMessage();
+    message = client2.receiveMessage();
+    BOOST_CHECK_EQUAL(message.code, OutCommandCode::MOVED);
+    BOOST_CHECK_EQUAL(message.message, "1 1 X " + nickname1);
+
+    client1.disconnect();
+    client2.disconnect();
+    server.stop();
+    serverThread.join();
+}
+
+BOOST_FIXTURE_TEST_CASE(GetGamesPagingTest, WsTestFixture)
+{
+    connectClients();
+
+    client1.sendMessage(InCommandCode::CREATE_GAME);
+    auto gameId1 = client1.receiveMessage().message;
+    client2.sendMessage(InCommandCode::CREATE_GAME);
+    auto gameId2 = client2.receiveMessage().message;
+
+    // Ids are slot handles, a reused slot may give the later game the larger id
+    auto first = gameId1 + '|' + nickname1;
+    auto second = gameId2 + '|' + nickname2;
+    if (std::stoul(gameId2) < std::stoul(gameId1)) {
+        std::swap(gameId1, gameId2);
+        std::swap(first, second);
+    }
+
+    // Earlier tests leave no waiting games behind
+    client1.sendMessage(InCommandCode::GET_GAMES, "1 " + std::to_string(std::stoul(gameId1) - 1));
+    auto message = client1.receiveMessage();
+    BOOST_CHECK_EQUAL(message.code, OutCommandCode::GAME_LIST);
+    BOOST_CHECK_EQUAL(message.message, first);
+
+    client1.sendMessage(InCommandCode::GET_GAMES, "5 " + gameId1);
+    BOOST_CHECK_EQUAL(client1.receiveMessage().message, second);
+
+    client1.sendMessage(InCommandCode::GET_GAMES, "0");
+    BOOST_CHECK_EQUAL(*client1.receiveMessage().errorCode, ErrorCode::INCORRECT_FORMAT);
+}
+
+BOOST_FIXTURE_TEST_CASE(CustomBoardGameTest, WsTestFixture)
+{
+    connectClients();
+
+    client1.sendMessage(InCommandCode::CREATE_GAME, "17 5");
+    auto message = client1.receiveMessage();
+    BOOST_CHECK_EQUAL(*message.errorCode, ErrorCode::ERROR_CREATE);
+
+    client1.sendMessage(InCommandCode::CREATE_GAME, "15 5");
+    auto gameId = client1.receiveMessage().message;
+    client2.sendMessage(InCommandCode::GET_GAMES, "1 " + std::to_string(std::stoul(gameId) - 1));
+    BOOST_CHECK_EQUAL(client2.receiveMessage().message, gameId + '|' + nickname1 + "|15|5");
+    client2.sendMessage(InCommandCode::JOIN_GAME, gameId);
+    message = client2.receiveMessage();
+    BOOST_CHECK_EQUAL(message.code, OutCommandCode::JOINED_GAME);
+    BOOST_CHECK_EQUAL(message.message, gameId + ' ' + nickname1 + " 15 5");
+    client1.receiveMessage();
+
+    client1.sendMessage(InCommandCode::MOVE, "14 14");
+    message = client2.receiveMessage();
+    BOOST_CHECK_EQUAL(message.code, OutCommandCode::MOVED);
+    BOOST_CHECK_EQUAL(message.message, "14 14 X " + nickname1);
+}
+
+BOOST_FIXTURE_TEST_CASE(BotGameTest, WsTestFixture)
+{
+    connectClients();
+
+    client1.sendMessage(InCommandCode::CREATE_GAME, "3 3 1");
+    auto message = client1.receiveMessage();
+    BOOST_CHECK_EQUAL(message.code, OutCommandCode::GAME_CREATED);
+    message = client1.receiveMessage();
+    BOOST_CHECK_EQUAL(message.code, OutCommandCode::OPPONENT_JOINED);
+    BOOST_CHECK_EQUAL(message.message, "bot");
+
+    client1.sendMessage(InCommandCode::MOVE, "0 0");
+    BOOST_CHECK_EQUAL(client1.receiveMessage().message, "0 0 X " + nickname1);
+    message = client1.receiveMessage();
+    BOOST_CHECK_EQUAL(message.code, OutCommandCode::MOVED);
+    BOOST_CHECK_EQUAL(message.message, "1 1 O bot");
+}
+
+BOOST_FIXTURE_TEST_CASE(MctsBotGameTest, WsTestFixture)
+{
+    connectClients();
+
+    client1.sendMessage(InCommandCode::CREATE_GAME, "15 5 1");
+    auto message = client1.receiveMessage();
+    BOOST_CHECK_EQUAL(message.code, OutCommandCode::GAME_CREATED);
+    message = client1.receiveMessage();
+    BOOST_CHECK_EQUAL(message.code, OutCommandCode::OPPONENT_JOINED);
+
+    client1.sendMessage(InCommandCode::MOVE, "7 7");
+    BOOST_CHECK_EQUAL(client1.receiveMessage().message, "7 7 X " + nickname1);
+    message = client1.receiveMessage();
+    BOOST_CHECK_EQUAL(message.code, OutCommandCode::MOVED);
+    BOOST_CHECK(message.message.ends_with(" O bot"));
+    BOOST_CHECK(!message.message.starts_with("7 7 "));
+}
+
 BOOST_FIXTURE_TEST_CASE(IncorrectCommandTest, WsTestFixture)
 {
     connectClients();
@@ -168,6 +384,25 @@ BOOST_FIXTURE_TEST_CASE(IncorrectCommandTest, WsTestFixture)
     BOOST_CHECK_EQUAL(*message.errorCode, ErrorCode::INCORRECT_FORMAT);
 }
 
+BOOST_FIXTURE_TEST_CASE(UnknownCommandTest, WsTestFixture)
+{
+    client1.connect();
+    client1.sendMessage(InCommandCode::CREATE_GAME);
+    auto message = client1.receiveMessage();
+    BOOST_CHECK_EQUAL(*message.errorCode, ErrorCode::ERROR_NOT_AUTH);
+
+    client1.sendMessage(InCommandCode::AUTH, nickname1);
+    client1.receiveMessage();
+
+    client1.sendMessage("42");
+    message = client1.receiveMessage();
+    BOOST_CHECK_EQUAL(*message.errorCode, ErrorCode::UNKNOWN_COMMAND);
+
+    client1.sendMessage("-1 0");
+    message = client1.receiveMessage();
+    BOOST_CHECK_EQUAL(*message.errorCode, ErrorCode::UNKNOWN_COMMAND);
+}
+
 BOOST_FIXTURE_TEST_CASE(InGameCommandOutsideGameErrorsTest, WsTestFixture)
 {
     connectClients();
@@ -328,6 +563,122 @@ BOOST_FIXTURE_TEST_CASE(WinGameTest, WsTestFixture)
     BOOST_CHECK_EQUAL(message.message, std::to_string(GameEndedCode::WIN) + ' ' + nickname1);
 }
 
+BOOST_FIXTURE_TEST_CASE(BatchedWinGameTest, WsTestFixture)
+{
+    client1.connect("/?batch=1");
+    client1.sendMessage(InCommandCode::AUTH, nickname1);
+    client1.receiveMessage();
+    client2.connect("/?batch=1");
+    client2.sendMessage(InCommandCode::AUTH, nickname2);
+    client2.receiveMessage();
+    createGame();
+
+    auto* mover = &client1;
+    auto* opponent = &client2;
+    for (auto move : {"0 0", "1 0", "0 1", "1 1"}) {
+        mover->sendMessage(InCommandCode::MOVE, move);
+        BOOST_CHECK_EQUAL(mover->receiveMessage().code, OutCommandCode::MOVED);
+        BOOST_CHECK_EQUAL(opponent->receiveMessage().code, OutCommandCode::MOVED);
+        std::swap(mover, opponent);
+    }
+
+    // MOVED and GAME_ENDED are queued by the same command and flushed as one frame
+    client1.sendMessage(InCommandCode::MOVE, "0 2");
+    BOOST_CHECK_EQUAL(client1.receiveMessage().code, OutCommandCode::MOVED);
+    auto message = client1.receiveMessage();
+    BOOST_CHECK_EQUAL(message.code, OutCommandCode::GAME_ENDED);
+    BOOST_CHECK_EQUAL(message.message, std::to_string(GameEndedCode::WIN) + ' ' + nickname1);
+
+    BOOST_CHECK_EQUAL(client2.receiveMessage().code, OutCommandCode::MOVED);
+    BOOST_CHECK_EQUAL(client2.receiveMessage().code, OutCommandCode::GAME_ENDED);
+}
+
+BOOST_FIXTURE_TEST_CASE(BinaryProtocolTest, WsTestFixture)
+{
+    auto command = [](InCommandCode code) { return std::string(1, static_cast<char>(code)); };
+
+    client1.connect("/?encoding=binary");
+    auto auth = command(InCommandCode::AUTH);
+    writeString(auth, nickname1);
+    client1.sendBinaryMessage(auth);
+    BOOST_CHECK_EQUAL(client1.receiveMessage().code, OutCommandCode::PLAYER_AUTHED);
+
+    client2.connect("/?encoding=binary&batch=1");
+    auth = command(InCommandCode::AUTH);
+    writeString(auth, nickname2);
+    client2.sendBinaryMessage(auth);
+    BOOST_CHECK_EQUAL(client2.receiveMessage().code, OutCommandCode::PLAYER_AUTHED);
+
+    client1.sendBinaryMessage(command(InCommandCode::CREATE_GAME));
+    auto message = client1.receiveMessage();
+    BOOST_CHECK_EQUAL(message.code, OutCommandCode::GAME_CREATED);
+    auto gameId = message.message;
+
+    client2.sendBinaryMessage(command(InCommandCode::JOIN_GAME)); // no game id
+    message = client2.receiveMessage();
+    BOOST_CHECK_EQUAL(*message.errorCode, ErrorCode::INCORRECT_FORMAT);
+
+    auto join = command(InCommandCode::JOIN_GAME);
+    writeVarint(join, std::stoul(gameId));
+    client2.sendBinaryMessage(join);
+    message = client2.receiveMessage();
+    BOOST_CHECK_EQUAL(message.code, OutCommandCode::JOINED_GAME);
+    BOOST_CHECK_EQUAL(message.message, gameId + ' ' + nickname1);
+    message = client1.receiveMessage();
+    BOOST_CHECK_EQUAL(message.code, OutCommandCode::OPPONENT_JOINED);
+    BOOST_CHECK_EQUAL(message.message, nickname2);
+
+    auto move = command(InCommandCode::MOVE) + packMove(2, 1);
+    client1.sendBinaryMessage(move);
+    message = client1.receiveMessage();
+    BOOST_CHECK_EQUAL(message.code, OutCommandCode::MOVED);
+    message = client2.receiveMessage();
+    BOOST_CHECK_EQUAL(message.code, OutCommandCode::MOVED);
+    BOOST_CHECK_EQUAL(message.message, "2 1 X " + nickname1);
+
+    client2.sendBinaryMessage(move);
+    message = client2.receiveMessage();
+    BOOST_CHECK_EQUAL(*message.errorCode, ErrorCode::ERROR_MOVE);
+}
+
+BOOST_FIXTURE_TEST_CASE(BinaryCustomBoardTest, WsTestFixture)
+{
+    auto command = [](InCommandCode code) { return std::string(1, static_cast<char>(code)); };
+
+    client1.connect("/?encoding=binary");
+    auto auth = command(InCommandCode::AUTH);
+    writeString(auth, nickname1);
+    client1.sendBinaryMessage(auth);
+    client1.receiveMessage();
+    client2.connect("/?encoding=binary");
+    auth = command(InCommandCode::AUTH);
+    writeString(auth, nickname2);
+    client2.sendBinaryMessage(auth);
+    client2.receiveMessage();
+
+    auto create = command(InCommandCode::CREATE_GAME);
+    writeVarint(create, 15);
+    writeVarint(create, 5);
+    client1.sendBinaryMessage(create);
+    auto gameId = client1.receiveMessage().message;
+
+    auto list = command(InCommandCode::GET_GAMES);
+    writeVarint(list, 1);
+    writeVarint(list, std::stoul(gameId) - 1);
+    client2.sendBinaryMessage(list);
+    auto message = client2.receiveMessage();
+    BOOST_CHECK_EQUAL(message.code, OutCommandCode::GAME_LIST);
+    BOOST_CHECK_EQUAL(message.message, gameId + '|' + nickname1 + "|15|5");
+
+    auto join = command(InCommandCode::JOIN_GAME);
+    writeVarint(join, std::stoul(gameId));
+    client2.sendBinaryMessage(join);
+    message = client2.receiveMessage();
+    BOOST_CHECK_EQUAL(message.code, OutCommandCode::JOINED_GAME);
+    BOOST_CHECK_EQUAL(message.message, gameId + ' ' + nickname1 + " 15 5");
+    client1.receiveMessage();
+}
+
 BOOST_FIXTURE_TEST_CASE(DrawGameTest, WsTestFixture)
 {
     connectClients();
@@ -377,3 +728,63 @@ BOOST_FIXTURE_TEST_CASE(DrawGameTest, WsTestFixture)
     BOOST_CHECK_EQUAL(message.code, OutCommandCode::GAME_ENDED);
     BOOST_CHECK_EQUAL(std::stoi(message.message), GameEndedCode::DRAW);
 }
+
+BOOST_AUTO_TEST_CASE(WriteQueueLimitsTest)
+{
+    auto stats = std::make_shared<ServerStats>();
+    auto message = [](size_t size) { return std::make_shared<const std::string>(size, 'x'); };
+
+    {
+        WriteQueue queue({ .maxBytes = 100, .maxMessages = 4, .policy = SlowConsumerPolicy::MergeLobby }, stats);
+        BOOST_CHECK(queue.push(message(10), MessageKind::Lobby));
+        queue.startWrite(1);
+        BOOST_CHECK(queue.push(message(10), MessageKind::Lobby));
+        BOOST_CHECK(queue.push(message(20), MessageKind::Lobby));
+        BOOST_CHECK_EQUAL(queue.size(), 2);
+        BOOST_CHECK_EQUAL(queue.bytes(), 30);
+        BOOST_CHECK_EQUAL(stats->mergedMessages, 1);
+        // A replacement that does not fit is dropped, the queued one stays
+        BOOST_CHECK(queue.push(message(95), MessageKind::Lobby));
+        BOOST_CHECK_EQUAL(queue.bytes(), 30);
+        BOOST_CHECK_EQUAL(stats->droppedMessages, 1);
+
+        // Critical messages evict the queued lobby message, but never the one in flight
+        BOOST_CHECK(queue.push(message(60), MessageKind::Critical));
+        BOOST_CHECK(queue.push(message(20), MessageKind::Critical));
+        BOOST_CHECK_EQUAL(queue.size(), 3);
+        BOOST_CHECK_EQUAL(stats->droppedMessages, 2);
+        BOOST_CHECK_EQUAL(stats->queuedBytes, 90);
+
+        BOOST_CHECK(!queue.push(message(20), MessageKind::Critical));
+        queue.finishWrite();
+        BOOST_CHECK_EQUAL(queue.bytes(), 80);
+    }
+    BOOST_CHECK_EQUAL(stats->queuedBytes, 0);
+    BOOST_CHECK_EQUAL(stats->queuedMessages, 0);
+
+    WriteQueue queue({ .maxBytes = 100, .maxMessages = 2, .policy = SlowConsumerPolicy::Close }, stats);
+    BOOST_CHECK(queue.push(message(1), MessageKind::Lobby));
+    BOOST_CHECK(queue.push(message(1), MessageKind::Lobby));
+    BOOST_CHECK(!queue.push(message(1), MessageKind::Lobby));
+}
+
+BOOST_AUTO_TEST_CASE(LobbyCacheTest)
+{
+    auto stats = std::make_shared<ServerStats>();
+    LobbyCache cache(stats);
+    int renders = 0;
+    auto render = [&renders]() { return std::to_string(++renders); };
+
+    auto first = cache.get(Encoding::Text, 1, render);
+    BOOST_CHECK_EQUAL(cache.get(Encoding::Text, 1, render), first);
+    BOOST_CHECK_EQUAL(*first, "1");
+
+    // Encodings are cached apart, a newer version renders again and an older one is served the newer lobby
+    BOOST_CHECK_EQUAL(*cache.get(Encoding::Binary, 1, render), "2");
+    BOOST_CHECK_EQUAL(*cache.get(Encoding::Text, 2, render), "3");
+    BOOST_CHECK_EQUAL(*cache.get(Encoding::Text, 1, render), "3");
+
+    BOOST_CHECK_EQUAL(stats->lobbyCacheHits, 2);
+    BOOST_CHECK_EQUAL(stats->lobbyCacheMisses, 3);
+    BOOST_CHECK_CLOSE(stats->lobbyCacheHitRate(), 0.4, 1e-9);
+}